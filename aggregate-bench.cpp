@@ -0,0 +1,88 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "aggregateavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Sums the values over random key ranges with AggregateAVLTree::aggregate
+ * and by iterating the same range of a plain AVLTree.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    const size_t queries = 20000;
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = 2 * i;
+    }
+    std::mt19937_64 rng(106);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    AggregateAVLTree<uint64_t, uint64_t> sums;
+    AVLTree<uint64_t, uint64_t> plain;
+    PerfCounters counters;
+
+    cout << "n = " << n << ", " << queries << " range sums" << endl;
+    printPerOperationHeader(cout);
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        plain.insert(std::make_pair(keys[i], keys[i] % 1000));
+    }
+    printPerOperation(cout, "AVLTree::insert", counters.stop(), n, counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        sums.insert(std::make_pair(keys[i], keys[i] % 1000));
+    }
+    printPerOperation(cout, "AggregateAVLTree::insert", counters.stop(), n, counters.available());
+
+    vector<pair<uint64_t, uint64_t> > ranges(queries);
+    for (size_t q = 0; q < queries; ++q) {
+        uint64_t lo = rng() % (2 * n);
+        ranges[q] = make_pair(lo, lo + rng() % (n / 5));
+    }
+
+    uint64_t total = 0;
+    counters.start();
+    for (size_t q = 0; q < queries; ++q) {
+        total += sums.aggregate(ranges[q].first, ranges[q].second);
+    }
+    printPerOperation(cout, "AggregateAVLTree::aggregate", counters.stop(), queries, counters.available());
+
+    uint64_t scanned = 0;
+    counters.start();
+    for (size_t q = 0; q < queries / 100; ++q) {
+        AVLTree<uint64_t, uint64_t>::iterator it = plain.lower_bound(ranges[q].first);
+        for (; it != plain.end() && it->first <= ranges[q].second; ++it) {
+            scanned += it->second;
+        }
+    }
+    printPerOperation(cout, "iterate range", counters.stop(), queries / 100, counters.available());
+
+    uint64_t check = 0;
+    for (size_t q = 0; q < queries / 100; ++q) {
+        check += sums.aggregate(ranges[q].first, ranges[q].second);
+    }
+    if (check != scanned) {
+        cout << "mismatch: " << check << " vs " << scanned << endl;
+        return 1;
+    }
+    sink = total + scanned;
+    return 0;
+}
@@ -0,0 +1,274 @@
+#ifndef AGGREGATEAVL_H
+#define AGGREGATEAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* An AVLNode that also stores the combination of every value in its subtree,
+* in key order.
+*/
+template <typename Key, typename Value>
+class AggregateNode : public AVLNode<Key, Value>
+{
+public:
+    AggregateNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~AggregateNode();
+    virtual Node<Key, Value>* clone() const;
+
+    const Value& getAggregate() const;
+    void setAggregate(const Value& aggregate);
+
+protected:
+    Value aggregate_;
+};
+
+template<class Key, class Value>
+AggregateNode<Key, Value>::AggregateNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), aggregate_(value)
+{
+
+}
+
+template<class Key, class Value>
+AggregateNode<Key, Value>::~AggregateNode()
+{
+
+}
+
+template<class Key, class Value>
+Node<Key, Value>* AggregateNode<Key, Value>::clone() const
+{
+    return new AggregateNode<Key, Value>(*this);
+}
+
+template<class Key, class Value>
+const Value& AggregateNode<Key, Value>::getAggregate() const
+{
+    return aggregate_;
+}
+
+template<class Key, class Value>
+void AggregateNode<Key, Value>::setAggregate(const Value& aggregate)
+{
+    aggregate_ = aggregate;
+}
+
+/**
+* An AVLTree that answers range aggregates in O(log n).  Combine is a
+* functor taking two Values and returning their combination; it must be
+* associative (sum, min, max, gcd, matrix product, ...) but need not be
+* commutative, since values are always combined in key order.  No identity
+* element is needed.
+*
+* Every node stores the combination of its subtree.  Rotations and bulk
+* builds refresh it through AVLTree::updateNode, and insert and remove walk
+* from the changed position to the root.
+*
+* Values must be changed through insert so the aggregates follow.  The
+* non-const operator[] is hidden for that reason; writing through an
+* iterator leaves the aggregates stale.
+*/
+template <class Key, class Value, class Combine = std::plus<Value>, class Compare = std::less<Key> >
+class AggregateAVLTree : public AVLTree<Key, Value, Compare>
+{
+public:
+    AggregateAVLTree();
+    explicit AggregateAVLTree(const Combine& combine, const Compare& comp = Compare());
+
+    using AVLTree<Key, Value, Compare>::insert;
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+
+    /**
+    * Combination of the values of every key in [lo, hi].  Throws
+    * std::out_of_range if no key is in the range.
+    */
+    Value aggregate(const Key& lo, const Key& hi) const;
+
+    Value const & operator[](const Key& key) const;
+
+    // Checks every node's stored aggregate against its subtree.
+    bool isValidAggregate() const;
+
+protected:
+    typedef AggregateNode<Key, Value> ANode;
+
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void updateNode(AVLNode<Key, Value>* node);
+    virtual void afterInsert(AVLNode<Key, Value>* node);
+    virtual void afterRemove(AVLNode<Key, Value>* parent);
+
+    // Adds value before or after acc; has says whether acc holds anything yet.
+    void prepend(Value& acc, bool& has, const Value& value) const;
+    void append(Value& acc, bool& has, const Value& value) const;
+    bool checkAggregate(ANode* node) const;
+
+    Combine combine_;
+};
+
+template<class Key, class Value, class Combine, class Compare>
+AggregateAVLTree<Key, Value, Combine, Compare>::AggregateAVLTree() :
+    AVLTree<Key, Value, Compare>(),
+    combine_()
+{
+
+}
+
+template<class Key, class Value, class Combine, class Compare>
+AggregateAVLTree<Key, Value, Combine, Compare>::AggregateAVLTree(const Combine& combine, const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp),
+    combine_(combine)
+{
+
+}
+
+template<class Key, class Value, class Combine, class Compare>
+AVLNode<Key, Value>* AggregateAVLTree<Key, Value, Combine, Compare>::createNode(const Key& key, const Value& value,
+                                                                                AVLNode<Key, Value>* parent)
+{
+    return new ANode(key, value, parent);
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten and the
+ * aggregates above it are recomputed.
+ */
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(new_item.first, parentNode, isLeft);
+    if (existing == NULL) {
+        this->insertAt(new_item, parentNode, isLeft);
+        return;
+    }
+    existing->setValue(new_item.second);
+    this->updatePathToRoot(static_cast<AVLNode<Key, Value>*>(existing));
+}
+
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::updateNode(AVLNode<Key, Value>* node)
+{
+    ANode* anode = static_cast<ANode*>(node);
+    ANode* left = static_cast<ANode*>(anode->getLeft());
+    ANode* right = static_cast<ANode*>(anode->getRight());
+    if (left == NULL && right == NULL) {
+        anode->setAggregate(anode->getValue());
+    } else if (right == NULL) {
+        anode->setAggregate(combine_(left->getAggregate(), anode->getValue()));
+    } else if (left == NULL) {
+        anode->setAggregate(combine_(anode->getValue(), right->getAggregate()));
+    } else {
+        anode->setAggregate(combine_(combine_(left->getAggregate(), anode->getValue()), right->getAggregate()));
+    }
+}
+
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::afterInsert(AVLNode<Key, Value>* node)
+{
+    this->updatePathToRoot(node);
+}
+
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::afterRemove(AVLNode<Key, Value>* parent)
+{
+    this->updatePathToRoot(parent);
+}
+
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::prepend(Value& acc, bool& has, const Value& value) const
+{
+    acc = has ? combine_(value, acc) : value;
+    has = true;
+}
+
+template<class Key, class Value, class Combine, class Compare>
+void AggregateAVLTree<Key, Value, Combine, Compare>::append(Value& acc, bool& has, const Value& value) const
+{
+    acc = has ? combine_(acc, value) : value;
+    has = true;
+}
+
+/**
+* Descends to the first node inside [lo, hi], where the paths to lo and hi
+* split.  Below its left child, every node at or above lo contributes itself
+* and its whole right subtree, each to the left of what was gathered so far;
+* the walk towards hi on the right side is the mirror image.  Both walks are
+* O(log n) long.
+*/
+template<class Key, class Value, class Combine, class Compare>
+Value AggregateAVLTree<Key, Value, Combine, Compare>::aggregate(const Key& lo, const Key& hi) const
+{
+    ANode* split = static_cast<ANode*>(this->root_);
+    while (split != NULL) {
+        if (this->probeGreater(lo, split->getKey(), IsThreeWayCompare<Compare, Key>())) {
+            split = static_cast<ANode*>(split->getRight());
+        } else if (this->probeLess(hi, split->getKey(), IsThreeWayCompare<Compare, Key>())) {
+            split = static_cast<ANode*>(split->getLeft());
+        } else {
+            break;
+        }
+    }
+    if (split == NULL) throw std::out_of_range("AggregateAVLTree: no key in range");
+
+    Value leftAcc = split->getValue();
+    bool hasLeft = true;
+    for (ANode* node = static_cast<ANode*>(split->getLeft()); node != NULL; ) {
+        if (this->probeGreater(lo, node->getKey(), IsThreeWayCompare<Compare, Key>())) {
+            node = static_cast<ANode*>(node->getRight());
+            continue;
+        }
+        ANode* right = static_cast<ANode*>(node->getRight());
+        if (right != NULL) prepend(leftAcc, hasLeft, right->getAggregate());
+        prepend(leftAcc, hasLeft, node->getValue());
+        node = static_cast<ANode*>(node->getLeft());
+    }
+
+    Value rightAcc = leftAcc;  // only read once hasRight is set
+    bool hasRight = false;
+    for (ANode* node = static_cast<ANode*>(split->getRight()); node != NULL; ) {
+        if (this->probeLess(hi, node->getKey(), IsThreeWayCompare<Compare, Key>())) {
+            node = static_cast<ANode*>(node->getLeft());
+            continue;
+        }
+        ANode* left = static_cast<ANode*>(node->getLeft());
+        if (left != NULL) append(rightAcc, hasRight, left->getAggregate());
+        append(rightAcc, hasRight, node->getValue());
+        node = static_cast<ANode*>(node->getRight());
+    }
+
+    return hasRight ? combine_(leftAcc, rightAcc) : leftAcc;
+}
+
+template<class Key, class Value, class Combine, class Compare>
+Value const & AggregateAVLTree<Key, Value, Combine, Compare>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Value, Compare>::operator[](key);
+}
+
+template<class Key, class Value, class Combine, class Compare>
+bool AggregateAVLTree<Key, Value, Combine, Compare>::checkAggregate(ANode* node) const
+{
+    if (node == NULL) return true;
+    ANode* left = static_cast<ANode*>(node->getLeft());
+    ANode* right = static_cast<ANode*>(node->getRight());
+    if (!checkAggregate(left) || !checkAggregate(right)) return false;
+
+    Value expected = node->getValue();
+    if (left != NULL) expected = combine_(left->getAggregate(), expected);
+    if (right != NULL) expected = combine_(expected, right->getAggregate());
+    return expected == node->getAggregate();
+}
+
+template<class Key, class Value, class Combine, class Compare>
+bool AggregateAVLTree<Key, Value, Combine, Compare>::isValidAggregate() const
+{
+    return checkAggregate(static_cast<ANode*>(this->root_));
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <atomic>
+
+/**
+ * Replaces the global operator new and delete to count every heap
+ * allocation the program makes, so benches and tests can show which
+ * lookups build temporary keys.  The array forms call these.  The
+ * replacements are real definitions, so include this header from exactly
+ * one translation unit of a program.  The count is atomic since trees may
+ * be walked or built on several threads.
+ */
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* block = malloc(size == 0 ? 1 : size);
+    if (block == NULL) throw std::bad_alloc();
+    return block;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size == 0 ? 1 : size);
+}
+
+void operator delete(void* block) noexcept
+{
+    free(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept
+{
+    free(block);
+}
+
+#endif
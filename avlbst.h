@@ -6,10 +6,31 @@
 #include <cstdlib>
 #include <cstdint>
 #include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <typeinfo>
 #include "bst.h"
+#include "serializer.h"
+#include "work_stealing_pool.h"
 
 struct KeyError { };
 
+/**
+* Header of the file written by AVLTree::save, followed by count entries in
+* key order: a height byte, then the key and value as encoded by Serializer.
+* Fields are in native byte order.
+*/
+struct AVLSnapshotHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint64_t count;
+    uint32_t keySize;
+    uint32_t valueSize;
+};
+
 /**
 * A special kind of node for an AVL tree, which adds the balance as a data member, plus
 * other additional helper functions. You do NOT need to implement any functionality or
@@ -22,6 +43,7 @@ public:
     // Constructor/destructor.
     AVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
     virtual ~AVLNode();
+    virtual Node<Key, Value>* clone() const;
 
     // Getter/setter for the node's height.
     int8_t getBalance () const;
@@ -64,6 +86,12 @@ AVLNode<Key, Value>::~AVLNode()
 
 }
 
+template<class Key, class Value>
+Node<Key, Value>* AVLNode<Key, Value>::clone() const
+{
+    return new AVLNode<Key, Value>(*this);
+}
+
 /**
 * A getter for the balance of a AVLNode.
 */
@@ -127,15 +155,172 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLTree : public BinarySearchTree<Key, Value, Compare>
 {
 public:
+    AVLTree();
+    explicit AVLTree(const Compare& comp);
+    // Builds the tree from unsorted items using threads workers (0: one per
+    // hardware thread).  Of several items with the same key the last one
+    // wins, as if they had been inserted in order.
+    explicit AVLTree(std::vector<std::pair<Key, Value> > items, size_t threads = 0,
+                     const Compare& comp = Compare());
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
-    virtual void remove(const Key& key);  // TODO
+
+    // Write the tree to path / replace the tree with the one stored at path.
+    // Both throw std::runtime_error on I/O errors or a malformed file.
+    void save(const std::string& path) const;
+    void load(const std::string& path);
+
+    // What merge does with a key both trees hold.
+    enum MergePolicy { KEEP_OURS, TAKE_THEIRS };
+
+    // Moves every item of other into this tree and leaves other empty.
+    // other must be of the same type as this tree, else
+    // std::invalid_argument is thrown.  It must also be ordered the same
+    // way, which is not checked: with a comparator that orders differently
+    // the result is not a valid search tree.  For a key in both trees,
+    // policy picks which item stays; TAKE_THEIRS matches insert.
+    void merge(AVLTree&& other, MergePolicy policy = TAKE_THEIRS);
+    // As above, but a key in both trees keeps the value combine(ours, theirs).
+    // If combine or a comparison throws, other is left empty and its items
+    // not yet moved are lost.  This tree keeps every key it had, those
+    // already combined with the combined value, plus other's items moved
+    // in before the throw.
+    template<typename Combine>
+    void merge(AVLTree&& other, Combine combine);
+
+    /**
+    * Owns a node taken out of a tree by extract, until insert links it
+    * into a tree again or the handle is destroyed.  The item stays where
+    * it was allocated, so moving it between trees copies nothing.  Only
+    * the value can be changed: the node holds its item as a
+    * std::pair<const Key, Value>, whose key cannot be written without
+    * destroying and rebuilding the pair.
+    */
+    class NodeHandle
+    {
+    public:
+        NodeHandle();
+        NodeHandle(NodeHandle&& other);
+        NodeHandle& operator=(NodeHandle&& other);
+        ~NodeHandle();
+
+        bool empty() const;
+        // Both throw std::logic_error on an empty handle.
+        const Key& key() const;
+        Value& value() const;
+
+    private:
+        friend class AVLTree<Key, Value, Compare>;
+        // origin is a reference so that insert({0, 0}) still means a pair
+        NodeHandle(AVLNode<Key, Value>* node, const std::type_info& origin);
+        NodeHandle(const NodeHandle&);
+        NodeHandle& operator=(const NodeHandle&);
+
+        AVLNode<Key, Value>* node_;
+        const std::type_info* origin_;  // the type of the tree it came from
+    };
+
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+
+    // Unlinks the item with the given key, or an empty handle if there is
+    // none, and hands over its node.
+    NodeHandle extract(const Key& key);
+    // Unlinks the item at pos; throws std::out_of_range for end().
+    NodeHandle extract(iterator pos);
+    // Links the handle's node into this tree and empties the handle.  If
+    // the key is already present the handle's node replaces that item, as
+    // insert overwrites the value.  Returns an iterator to the item, or
+    // end() for an empty handle.  Throws std::invalid_argument if the node
+    // came from a different type of tree; the handle keeps it then.
+    iterator insert(NodeHandle&& handle);
 protected:
+    // removeNode unlinks the node and deletes it; unlinkNode only unlinks
+    // it, rebalancing and running afterRemove, so it can be handed out.
+    virtual void removeNode(Node<Key, Value>* target);
+    void unlinkNode(AVLNode<Key, Value>* node);
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
 
+    // For subclasses' own extract and insert: wraps an unlinked node in a
+    // handle, and takes the node back out after checking where it came from.
+    NodeHandle handleFor(AVLNode<Key, Value>* node) const;
+    AVLNode<Key, Value>* takeNode(NodeHandle& handle) const;
+
+    // Allocates the node for a new item; subclasses override it to use
+    // their own AVLNode subclass.  buildFromUnsorted calls it from several
+    // threads at once, so an override may only allocate and must update
+    // any state it keeps in the tree atomically.
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    // Adds a new item where findPosition said it belongs and rebalances.
+    void insertAt(const std::pair<const Key, Value>& new_item, Node<Key, Value>* parentNode, bool isLeft);
+    // The same for a node that is already allocated and in no tree.
+    void linkNode(AVLNode<Key, Value>* newNode, Node<Key, Value>* parentNode, bool isLeft);
+
+    // Replaces the tree with a minimum-height tree linking the given nodes,
+    // which must be in key order and detached from any tree.
+    void buildFromSorted(const std::vector<AVLNode<Key, Value>*>& nodes);
+    AVLNode<Key, Value>* buildRange(const std::vector<AVLNode<Key, Value>*>& nodes,
+                                    size_t lo, size_t hi, AVLNode<Key, Value>* parent);
+    static int8_t rangeBalance(size_t lo, size_t mid, size_t hi);
+
+    // Replaces the tree with the given items, sorting them and building the
+    // result in parallel.  The constructor above uses it; subclasses call it
+    // from their own constructors so their createNode is the one used (and
+    // their clear, which it calls first).
+    void buildFromUnsorted(std::vector<std::pair<Key, Value> >& items, size_t threads);
+    void sortItems(std::vector<std::pair<Key, Value> >& items, WorkStealingPool& pool);
+    AVLNode<Key, Value>* buildTop(const std::vector<AVLNode<Key, Value>*>& nodes, size_t lo, size_t hi,
+                                  AVLNode<Key, Value>* parent, int depth, WorkStealingPool& pool);
+    void finishTop(const std::vector<AVLNode<Key, Value>*>& nodes, size_t lo, size_t hi, int depth);
+
+    // The merge itself.  resolve(ours, theirs) returns which of two nodes
+    // with equal keys to keep, and the other is deleted.  It links the two trees' nodes into one new tree,
+    // or moves other's nodes in one at a time when other is much smaller.
+    template<typename Resolve>
+    void mergeNodes(AVLTree& other, Resolve resolve);
+    template<typename Resolve>
+    size_t mergeLinear(AVLNode<Key, Value>* ours, AVLNode<Key, Value>* theirs, Resolve resolve);
+    template<typename Resolve>
+    size_t mergeByInsert(AVLNode<Key, Value>* theirs, Resolve resolve);
+    static int heightOf(AVLNode<Key, Value>* root);
+    // Rotates the smallest node of the tree under top up to the top.
+    static AVLNode<Key, Value>* toFront(AVLNode<Key, Value>* top);
+    // Turns the tree under root into a list in key order, linked through
+    // the right pointers, and returns its head.
+    static AVLNode<Key, Value>* toVine(AVLNode<Key, Value>* root);
+    static void deleteVine(AVLNode<Key, Value>* head);
+    // Like buildRange, taking the nodes from the front of a vine.
+    AVLNode<Key, Value>* buildFromVine(AVLNode<Key, Value>*& head, size_t lo, size_t hi,
+                                       AVLNode<Key, Value>* parent);
+    // Puts node, which is in no tree, where old is, and unlinks old.
+    void replaceNode(AVLNode<Key, Value>* old, AVLNode<Key, Value>* node);
+    // Called by merge before it takes other's nodes, and at the end with
+    // the number of keys other added to this tree (or, if the merge threw,
+    // however many it got to).
+    virtual void beforeMerge(AVLTree& other);
+    virtual void afterMerge(size_t added);
+
+    // Hooks for trees that keep a summary of each subtree in their nodes.
+    // updateNode recomputes node's summary from its children and is called
+    // whenever node's children change under a rotation or a bulk build.
+    // afterInsert gets the new node and afterRemove the parent of the node
+    // that was unlinked, once rebalancing is done; the summaries on the path
+    // from there to the root are stale until updatePathToRoot runs.
+    virtual void updateNode(AVLNode<Key, Value>* node);
+    virtual void afterInsert(AVLNode<Key, Value>* node);
+    virtual void afterRemove(AVLNode<Key, Value>* parent);
+    void updatePathToRoot(AVLNode<Key, Value>* node);
+
+    // The pieces of save, for subclasses that write a different set of
+    // nodes: startSnapshot opens path and writes a placeholder header,
+    // writeSnapshotEntry appends one node with its height, and
+    // finishSnapshot fills in the count and checks the stream.
+    static void startSnapshot(std::ofstream& out, const std::string& path);
+    static void writeSnapshotEntry(std::ostream& out, int height, const Node<Key, Value>* node);
+    static void finishSnapshot(std::ofstream& out, const std::string& path, uint64_t count);
+
     // Add helper functions here
     void rotateLeft(AVLNode<Key, Value>* node);
     void rotateRight(AVLNode<Key, Value>* node);
@@ -143,70 +328,122 @@ protected:
     void removeFix(AVLNode<Key, Value>* node, int diff);
 };
 
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree() :
+    BinarySearchTree<Key, Value, Compare>()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::AVLTree(std::vector<std::pair<Key, Value> > items, size_t threads,
+                                      const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+    buildFromUnsorted(items, threads);
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(new_item.first, parentNode, isLeft);
+    if(existing != NULL)
+    {
+        existing->setValue(new_item.second);
+        return;
+    }
+    insertAt(new_item, parentNode, isLeft);
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::createNode(const Key& key, const Value& value,
+                                                              AVLNode<Key, Value>* parent)
+{
+    return new AVLNode<Key, Value>(key, value, parent);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insertAt(const std::pair<const Key, Value>& new_item,
+                                            Node<Key, Value>* parentNode, bool isLeft)
+{
+    linkNode(createNode(new_item.first, new_item.second, static_cast<AVLNode<Key, Value>*>(parentNode)),
+             parentNode, isLeft);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::linkNode(AVLNode<Key, Value>* newNode, Node<Key, Value>* parentNode, bool isLeft)
 {
-    AVLNode<Key, Value>* curr = static_cast<AVLNode<Key, Value>*>(this->internalFind(new_item.first));
-    AVLNode<Key, Value>* newNode = NULL;
-    if(curr == NULL)
+    AVLNode<Key, Value>* parent = static_cast<AVLNode<Key, Value>*>(parentNode);
+    newNode->setParent(parent);
+    newNode->setLeft(NULL);
+    newNode->setRight(NULL);
+    newNode->setBalance(0);
+    // a reused node may carry the summary of its old subtree, and the
+    // rotations below read it
+    updateNode(newNode);
+    if(parent == NULL)
     {
-        if(this->root_ == NULL)
+        this->root_ = newNode;
+    }
+    else
+    {
+        if(isLeft)
         {
-            this->root_ = new AVLNode<Key, Value>(new_item.first, new_item.second, NULL);
-            return;
+            parent->setLeft(newNode);
+            parent->updateBalance(-1);
         }
         else
         {
-            curr = static_cast<AVLNode<Key, Value>*>(this->root_);
-            while(curr != NULL)
-            {
-                if(new_item.first < curr->getKey())
-                {
-                    if(curr->getLeft() == NULL)
-                    {
-                        newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, curr);
-                        curr->setLeft(newNode);
-                        curr->updateBalance(-1);
-                        if (curr->getBalance() != 0)
-                            insertFix(curr, newNode);
-                        break;
-                    }
-                    else
-                    {
-                        curr = curr->getLeft();
-                    }
-                }
-                else if(new_item.first > curr->getKey())
-                {
-                    if(curr->getRight() == NULL)
-                    {
-                        newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, curr);
-                        curr->setRight(newNode);
-                        curr->updateBalance(1);
-                        if (curr->getBalance() != 0)
-                            insertFix(curr, newNode);
-                        break;
-                    }
-                    else
-                    {
-                        curr = curr->getRight();
-                    }
-                }
-                else
-                {
-                    curr->setValue(new_item.second);
-                    return;
-                }
-            }
+            parent->setRight(newNode);
+            parent->updateBalance(1);
         }
+        if (parent->getBalance() != 0)
+            insertFix(parent, newNode);
     }
-    else
-    {
-        curr->setValue(new_item.second);
+    afterInsert(newNode);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::updateNode(AVLNode<Key, Value>* /*node*/)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::afterInsert(AVLNode<Key, Value>* /*node*/)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::afterRemove(AVLNode<Key, Value>* /*parent*/)
+{
+
+}
+
+/**
+* Rotations keep the summaries of the nodes they move correct, and every
+* other node whose subtree changed is an ancestor of the inserted or
+* removed position, so one walk up from there finishes the job.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::updatePathToRoot(AVLNode<Key, Value>* node)
+{
+    for (; node != NULL; node = node->getParent()) {
+        updateNode(node);
     }
 }
 
@@ -214,12 +451,18 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
  * Recall: The writeup specifies that if a node has 2 children you
  * should swap with the predecessor and then remove.
  */
-template<class Key, class Value>
-void AVLTree<Key, Value>::remove(const Key& key)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::removeNode(Node<Key, Value>* target)
 {
-    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(target);
     if (node == NULL) return;
+    unlinkNode(node);
+    delete node;
+}
 
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::unlinkNode(AVLNode<Key, Value>* node)
+{
     if (node->getLeft() != NULL && node->getRight() != NULL) {
         AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(node));
         nodeSwap(node, pred);
@@ -258,11 +501,144 @@ void AVLTree<Key, Value>::remove(const Key& key)
         removeFix(parent, diff);
     }
 
-    delete node;
+    afterRemove(parent);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* node)
+/*
+-----------------------------------------------
+Begin implementations for the NodeHandle class.
+-----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::NodeHandle::NodeHandle() :
+    node_(NULL), origin_(NULL)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::NodeHandle::NodeHandle(AVLNode<Key, Value>* node, const std::type_info& origin) :
+    node_(node), origin_(&origin)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::NodeHandle::NodeHandle(NodeHandle&& other) :
+    node_(other.node_), origin_(other.origin_)
+{
+    other.node_ = NULL;
+}
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::NodeHandle&
+AVLTree<Key, Value, Compare>::NodeHandle::operator=(NodeHandle&& other)
+{
+    if (this == &other) return *this;
+    delete node_;
+    node_ = other.node_;
+    origin_ = other.origin_;
+    other.node_ = NULL;
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+AVLTree<Key, Value, Compare>::NodeHandle::~NodeHandle()
+{
+    delete node_;
+}
+
+template<class Key, class Value, class Compare>
+bool AVLTree<Key, Value, Compare>::NodeHandle::empty() const
+{
+    return node_ == NULL;
+}
+
+template<class Key, class Value, class Compare>
+const Key& AVLTree<Key, Value, Compare>::NodeHandle::key() const
+{
+    if (node_ == NULL) throw std::logic_error("NodeHandle: empty handle");
+    return node_->getItem().first;
+}
+
+template<class Key, class Value, class Compare>
+Value& AVLTree<Key, Value, Compare>::NodeHandle::value() const
+{
+    if (node_ == NULL) throw std::logic_error("NodeHandle: empty handle");
+    return node_->getValue();
+}
+
+/*
+------------------------------------------------------
+End implementations for the NodeHandle class.
+------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::NodeHandle
+AVLTree<Key, Value, Compare>::extract(const Key& key)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
+    if (node == NULL) return NodeHandle();
+    unlinkNode(node);
+    return handleFor(node);
+}
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::NodeHandle
+AVLTree<Key, Value, Compare>::extract(iterator pos)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->nodeAt(pos));
+    if (node == NULL) throw std::out_of_range("AVLTree::extract: end iterator");
+    unlinkNode(node);
+    return handleFor(node);
+}
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::iterator
+AVLTree<Key, Value, Compare>::insert(NodeHandle&& handle)
+{
+    if (handle.empty()) return this->end();
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(handle.key(), parentNode, isLeft);
+    AVLNode<Key, Value>* node = takeNode(handle);
+    if (existing == NULL) {
+        linkNode(node, parentNode, isLeft);
+    } else {
+        AVLNode<Key, Value>* old = static_cast<AVLNode<Key, Value>*>(existing);
+        replaceNode(old, node);
+        delete old;
+        updatePathToRoot(node);
+    }
+    return this->iteratorAt(node);
+}
+
+template<class Key, class Value, class Compare>
+typename AVLTree<Key, Value, Compare>::NodeHandle
+AVLTree<Key, Value, Compare>::handleFor(AVLNode<Key, Value>* node) const
+{
+    return NodeHandle(node, typeid(*this));
+}
+
+/**
+* A node from another type of tree may be of another AVLNode subclass,
+* which this tree's hooks would misread.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::takeNode(NodeHandle& handle) const
+{
+    if (*handle.origin_ != typeid(*this)) {
+        throw std::invalid_argument("AVLTree::insert: node handle from a different type of tree");
+    }
+    AVLNode<Key, Value>* node = handle.node_;
+    handle.node_ = NULL;
+    return node;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* node)
 {
     if (parent == NULL || parent->getParent() == NULL) return;
 
@@ -350,8 +726,8 @@ void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Va
     }
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int diff)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::removeFix(AVLNode<Key, Value>* node, int diff)
 {
     if (node == NULL) return;
 
@@ -463,8 +839,8 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int diff)
     }
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* node)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rotateLeft(AVLNode<Key, Value>* node)
 {
     AVLNode<Key, Value>* right = node->getRight();
     AVLNode<Key, Value>* parent = node->getParent();
@@ -483,10 +859,12 @@ void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* node)
     } else {
         parent->setRight(right);
     }
+    updateNode(node);
+    updateNode(right);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* node)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::rotateRight(AVLNode<Key, Value>* node)
 {
     AVLNode<Key, Value>* left = node->getLeft();
     AVLNode<Key, Value>* parent = node->getParent();
@@ -505,15 +883,618 @@ void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* node)
     } else {
         parent->setRight(left);
     }
+    updateNode(node);
+    updateNode(left);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
 }
 
-#endif
\ No newline at end of file
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::buildFromSorted(const std::vector<AVLNode<Key, Value>*>& nodes)
+{
+    this->root_ = nodes.empty() ? NULL : buildRange(nodes, 0, nodes.size(), NULL);
+}
+
+/**
+* Links nodes[lo, hi) under parent with the middle node as the subtree root.
+* The left half gets the extra node when the count is even, and a
+* minimum-height tree of s nodes has height bit_length(s), so the balance
+* follows from the two halves' sizes without measuring anything.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::buildRange(const std::vector<AVLNode<Key, Value>*>& nodes,
+                                                              size_t lo, size_t hi, AVLNode<Key, Value>* parent)
+{
+    if (lo == hi) return NULL;
+    size_t mid = lo + (hi - lo) / 2;
+    AVLNode<Key, Value>* node = nodes[mid];
+    node->setParent(parent);
+    node->setLeft(buildRange(nodes, lo, mid, node));
+    node->setRight(buildRange(nodes, mid + 1, hi, node));
+    node->setBalance(rangeBalance(lo, mid, hi));
+    updateNode(node);
+    return node;
+}
+
+template<class Key, class Value, class Compare>
+int8_t AVLTree<Key, Value, Compare>::rangeBalance(size_t lo, size_t mid, size_t hi)
+{
+    int leftHeight = 0;
+    int rightHeight = 0;
+    for (size_t size = mid - lo; size != 0; size >>= 1) ++leftHeight;
+    for (size_t size = hi - mid - 1; size != 0; size >>= 1) ++rightHeight;
+    return (int8_t)(rightHeight - leftHeight);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::merge(AVLTree&& other, MergePolicy policy)
+{
+    mergeNodes(other, [policy](AVLNode<Key, Value>* ours, AVLNode<Key, Value>* theirs) {
+        return policy == KEEP_OURS ? ours : theirs;
+    });
+}
+
+template<class Key, class Value, class Compare>
+template<typename Combine>
+void AVLTree<Key, Value, Compare>::merge(AVLTree&& other, Combine combine)
+{
+    mergeNodes(other, [&combine](AVLNode<Key, Value>* ours, AVLNode<Key, Value>* theirs) {
+        ours->setValue(combine(ours->getValue(), theirs->getValue()));
+        return ours;
+    });
+}
+
+/**
+* Merging trees of n and m items by linking all nodes into a new tree is
+* O(n + m), and inserting other's nodes one at a time is O(m log n); the
+* latter also walks other's items in key order, so its descents share most
+* of their path.  Measured with merge-bench, linking wins once m is about
+* an eighth of n or more, which is where the heights differ by three.
+*/
+template<class Key, class Value, class Compare>
+template<typename Resolve>
+void AVLTree<Key, Value, Compare>::mergeNodes(AVLTree& other, Resolve resolve)
+{
+    if (&other == this || other.root_ == NULL) return;
+    if (typeid(*this) != typeid(other)) {
+        throw std::invalid_argument("AVLTree::merge: trees of different types");
+    }
+    beforeMerge(other);
+
+    AVLNode<Key, Value>* ours = static_cast<AVLNode<Key, Value>*>(this->root_);
+    AVLNode<Key, Value>* theirs = static_cast<AVLNode<Key, Value>*>(other.root_);
+    other.root_ = NULL;
+    size_t added = heightOf(theirs) + 3 <= heightOf(ours)
+        ? mergeByInsert(theirs, resolve)
+        : mergeLinear(ours, theirs, resolve);
+    afterMerge(added);
+}
+
+/**
+* Walks both trees in key order, merging them like two sorted lists into
+* one vine (a list linked through the right pointers), then links the
+* vine into a minimum-height tree with no rotations left to do.  The walk
+* pulls each tree's next node to the front with right rotations, as toVine
+* does, so flattening and merging share one pass over the nodes.  No node
+* is allocated; the losers of equal keys are deleted.
+*
+* If a comparison or resolve throws, the merged vine so far is followed by
+* the rest of ours, which still sorts after it, and relinked into this
+* tree; only the rest of theirs is deleted.
+*/
+template<class Key, class Value, class Compare>
+template<typename Resolve>
+size_t AVLTree<Key, Value, Compare>::mergeLinear(AVLNode<Key, Value>* ours, AVLNode<Key, Value>* theirs,
+                                                 Resolve resolve)
+{
+    this->root_ = NULL;
+    ours = toFront(ours);
+    theirs = toFront(theirs);
+
+    AVLNode<Key, Value>* head = NULL;
+    AVLNode<Key, Value>* tail = NULL;
+    size_t count = 0;
+    size_t added = 0;
+    try {
+        while (ours != NULL && theirs != NULL) {
+            AVLNode<Key, Value>* next;
+            if (this->probeLess(theirs->getKey(), ours->getKey(), IsThreeWayCompare<Compare, Key>())) {
+                next = theirs;
+                theirs = toFront(theirs->getRight());
+                ++added;
+            } else if (this->probeLess(ours->getKey(), theirs->getKey(), IsThreeWayCompare<Compare, Key>())) {
+                next = ours;
+                ours = toFront(ours->getRight());
+            } else {
+                next = resolve(ours, theirs);
+                AVLNode<Key, Value>* loser = next == ours ? theirs : ours;
+                ours = toFront(ours->getRight());
+                theirs = toFront(theirs->getRight());
+                delete loser;
+            }
+            if (tail == NULL) {
+                head = next;
+            } else {
+                tail->setRight(next);
+            }
+            tail = next;
+            ++count;
+        }
+    } catch (...) {
+        AVLNode<Key, Value>* rest = toVine(ours);
+        if (tail == NULL) {
+            head = rest;
+        } else {
+            tail->setRight(rest);
+        }
+        for (; rest != NULL; rest = rest->getRight()) ++count;
+        this->root_ = buildFromVine(head, 0, count, NULL);
+        deleteVine(toVine(theirs));
+        afterMerge(added);
+        throw;
+    }
+
+    AVLNode<Key, Value>* rest = toVine(ours != NULL ? ours : theirs);
+    if (tail == NULL) {
+        head = rest;
+    } else {
+        tail->setRight(rest);
+    }
+    for (; rest != NULL; rest = rest->getRight()) {
+        ++count;
+        if (theirs != NULL) ++added;
+    }
+
+    this->root_ = buildFromVine(head, 0, count, NULL);
+    return added;
+}
+
+/**
+* Flattens other into a vine, then links its nodes into this tree one by
+* one as insert would, without allocating.  A node replacing one of ours
+* takes its place, balance and all, so only the summaries on its path need
+* recomputing.
+*
+* If a comparison or resolve throws, the nodes not yet moved are deleted.
+*/
+template<class Key, class Value, class Compare>
+template<typename Resolve>
+size_t AVLTree<Key, Value, Compare>::mergeByInsert(AVLNode<Key, Value>* theirs, Resolve resolve)
+{
+    theirs = toVine(theirs);
+    size_t added = 0;
+    try {
+        while (theirs != NULL) {
+            AVLNode<Key, Value>* node = theirs;
+            Node<Key, Value>* parent = NULL;
+            bool isLeft = false;
+            Node<Key, Value>* existing = this->findPosition(node->getKey(), parent, isLeft);
+
+            if (existing == NULL) {
+                theirs = theirs->getRight();
+                linkNode(node, parent, isLeft);
+                ++added;
+                continue;
+            }
+            AVLNode<Key, Value>* ours = static_cast<AVLNode<Key, Value>*>(existing);
+            AVLNode<Key, Value>* kept = resolve(ours, node);
+            theirs = theirs->getRight();
+            if (kept == node) {
+                replaceNode(ours, node);
+                delete ours;
+            } else {
+                delete node;
+            }
+            updatePathToRoot(kept);
+        }
+    } catch (...) {
+        deleteVine(theirs);
+        afterMerge(added);
+        throw;
+    }
+    return added;
+}
+
+/**
+* Follows the taller child down, as the balance factors say.
+*/
+template<class Key, class Value, class Compare>
+int AVLTree<Key, Value, Compare>::heightOf(AVLNode<Key, Value>* root)
+{
+    int height = 0;
+    for (AVLNode<Key, Value>* node = root; node != NULL; ++height) {
+        node = node->getBalance() < 0 ? node->getLeft() : node->getRight();
+    }
+    return height;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::replaceNode(AVLNode<Key, Value>* old, AVLNode<Key, Value>* node)
+{
+    AVLNode<Key, Value>* parent = old->getParent();
+    node->setParent(parent);
+    node->setLeft(old->getLeft());
+    node->setRight(old->getRight());
+    node->setBalance(old->getBalance());
+    if (node->getLeft() != NULL) node->getLeft()->setParent(node);
+    if (node->getRight() != NULL) node->getRight()->setParent(node);
+    if (parent == NULL) {
+        this->root_ = node;
+    } else if (parent->getLeft() == old) {
+        parent->setLeft(node);
+    } else {
+        parent->setRight(node);
+    }
+}
+
+/**
+* Rotates right at the top until it has no left child, which brings the
+* smallest node of the tree to the top.  Each rotation moves a node onto
+* the right spine for good, so pulling every node out this way is O(n) in
+* total.  Parent links are left stale; buildFromVine resets them.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::toFront(AVLNode<Key, Value>* top)
+{
+    if (top == NULL) return NULL;
+    for (AVLNode<Key, Value>* left = top->getLeft(); left != NULL; left = top->getLeft()) {
+        top->setLeft(left->getRight());
+        left->setRight(top);
+        top = left;
+    }
+    return top;
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::toVine(AVLNode<Key, Value>* root)
+{
+    AVLNode<Key, Value>* head = toFront(root);
+    for (AVLNode<Key, Value>* node = head; node != NULL; node = node->getRight()) {
+        node->setRight(toFront(node->getRight()));
+    }
+    return head;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::deleteVine(AVLNode<Key, Value>* head)
+{
+    while (head != NULL) {
+        AVLNode<Key, Value>* doomed = head;
+        head = head->getRight();
+        delete doomed;
+    }
+}
+
+/**
+* Builds the left subtree first, which consumes exactly the nodes before
+* the middle one, so the vine is read front to back once.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::buildFromVine(AVLNode<Key, Value>*& head, size_t lo, size_t hi,
+                                                                 AVLNode<Key, Value>* parent)
+{
+    if (lo == hi) return NULL;
+    size_t mid = lo + (hi - lo) / 2;
+    AVLNode<Key, Value>* left = buildFromVine(head, lo, mid, NULL);
+    AVLNode<Key, Value>* node = head;
+    head = head->getRight();
+    node->setParent(parent);
+    node->setLeft(left);
+    if (left != NULL) left->setParent(node);
+    node->setRight(buildFromVine(head, mid + 1, hi, node));
+    node->setBalance(rangeBalance(lo, mid, hi));
+    updateNode(node);
+    return node;
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::beforeMerge(AVLTree& /*other*/)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::afterMerge(size_t /*added*/)
+{
+
+}
+
+/**
+* Sorts the items (stably, so equal keys keep their input order), keeps the
+* last item of each run of equal keys, allocates the nodes, and links them
+* with buildRange.  Every step but the deduplication is split over the
+* workers; items is left sorted and deduplicated.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::buildFromUnsorted(std::vector<std::pair<Key, Value> >& items, size_t threads)
+{
+    this->clear();
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    // below this many items per thread the pool costs more than it saves
+    if (items.size() < 4096 * threads) threads = 1;
+    WorkStealingPool pool(threads);
+
+    sortItems(items, pool);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (i + 1 < items.size() &&
+            !this->probeLess(items[i].first, items[i + 1].first, IsThreeWayCompare<Compare, Key>())) {
+            continue;
+        }
+        if (kept != i) items[kept] = std::move(items[i]);
+        ++kept;
+    }
+    items.resize(kept);
+
+    std::vector<AVLNode<Key, Value>*> nodes(kept, NULL);
+    size_t chunk = (kept + threads - 1) / threads;
+    for (size_t lo = 0; lo < kept; lo += chunk) {
+        size_t hi = std::min(kept, lo + chunk);
+        pool.submit([this, &items, &nodes, lo, hi] {
+            for (size_t i = lo; i < hi; ++i) {
+                nodes[i] = createNode(items[i].first, items[i].second, NULL);
+            }
+        });
+    }
+    try {
+        pool.wait();
+    } catch (...) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            delete nodes[i];
+        }
+        throw;
+    }
+
+    if (threads == 1) {
+        buildFromSorted(nodes);
+        return;
+    }
+    int depth = 0;
+    while (((size_t)1 << depth) < 4 * threads) {
+        ++depth;
+    }
+    this->root_ = buildTop(nodes, 0, kept, NULL, depth, pool);
+    pool.wait();
+    finishTop(nodes, 0, kept, depth);
+}
+
+/**
+* Stable sorts one chunk per worker, then merges neighbouring chunks in
+* rounds, each round's merges running in parallel.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::sortItems(std::vector<std::pair<Key, Value> >& items, WorkStealingPool& pool)
+{
+    auto less = [this](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) {
+        return this->probeLess(a.first, b.first, IsThreeWayCompare<Compare, Key>());
+    };
+    typedef typename std::vector<std::pair<Key, Value> >::iterator ItemIterator;
+
+    size_t chunks = pool.size();
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds.push_back(items.size() * i / chunks);
+    }
+    for (size_t i = 0; i < chunks; ++i) {
+        ItemIterator first = items.begin() + bounds[i];
+        ItemIterator last = items.begin() + bounds[i + 1];
+        pool.submit([first, last, less] { std::stable_sort(first, last, less); });
+    }
+    pool.wait();
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+        for (size_t i = 0; i + width < chunks; i += 2 * width) {
+            ItemIterator first = items.begin() + bounds[i];
+            ItemIterator middle = items.begin() + bounds[i + width];
+            ItemIterator last = items.begin() + bounds[std::min(chunks, i + 2 * width)];
+            pool.submit([first, middle, last, less] { std::inplace_merge(first, middle, last, less); });
+        }
+        pool.wait();
+    }
+}
+
+/**
+* Links the top depth levels of the tree buildRange would produce, and hands
+* each subtree below them to the pool.  The subtree roots are known without
+* building anything: buildRange always picks the middle node.
+*/
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare>::buildTop(const std::vector<AVLNode<Key, Value>*>& nodes,
+                                                            size_t lo, size_t hi, AVLNode<Key, Value>* parent,
+                                                            int depth, WorkStealingPool& pool)
+{
+    if (lo == hi) return NULL;
+    size_t mid = lo + (hi - lo) / 2;
+    if (depth == 0) {
+        pool.submit([this, &nodes, lo, hi, parent] { buildRange(nodes, lo, hi, parent); });
+        return nodes[mid];
+    }
+
+    AVLNode<Key, Value>* node = nodes[mid];
+    node->setParent(parent);
+    node->setLeft(buildTop(nodes, lo, mid, node, depth - 1, pool));
+    node->setRight(buildTop(nodes, mid + 1, hi, node, depth - 1, pool));
+    node->setBalance(rangeBalance(lo, mid, hi));
+    return node;
+}
+
+/**
+* Runs updateNode on the nodes buildTop linked, bottom up, once the subtrees
+* below them are complete.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::finishTop(const std::vector<AVLNode<Key, Value>*>& nodes,
+                                             size_t lo, size_t hi, int depth)
+{
+    if (lo == hi || depth == 0) return;
+    size_t mid = lo + (hi - lo) / 2;
+    finishTop(nodes, lo, mid, depth - 1);
+    finishTop(nodes, mid + 1, hi, depth - 1);
+    updateNode(nodes[mid]);
+}
+
+/**
+* Walks the tree in order with an explicit stack, deriving each node's height
+* from its parent's height and balance, so the writer never recurses and
+* never visits a node twice.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::save(const std::string& path) const
+{
+    std::ofstream out;
+    startSnapshot(out, path);
+
+    // the root's height is the length of the path that follows the taller side
+    int height = 0;
+    for (AVLNode<Key, Value>* n = static_cast<AVLNode<Key, Value>*>(this->root_); n != NULL;
+         n = n->getBalance() < 0 ? n->getLeft() : n->getRight()) {
+        ++height;
+    }
+
+    uint64_t count = 0;
+    std::vector<std::pair<AVLNode<Key, Value>*, int> > pending;
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->root_);
+    while (node != NULL || !pending.empty()) {
+        while (node != NULL) {
+            pending.push_back(std::make_pair(node, height));
+            height -= node->getBalance() <= 0 ? 1 : 2;
+            node = node->getLeft();
+        }
+        node = pending.back().first;
+        height = pending.back().second;
+        pending.pop_back();
+
+        writeSnapshotEntry(out, height, node);
+        ++count;
+
+        height -= node->getBalance() >= 0 ? 1 : 2;
+        node = node->getRight();
+    }
+
+    finishSnapshot(out, path, count);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::startSnapshot(std::ofstream& out, const std::string& path)
+{
+    out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("AVLTree::save: cannot open " + path);
+    AVLSnapshotHeader header = { {'A', 'V', 'L', 'S'}, 1, 0, sizeof(Key), sizeof(Value) };
+    Serializer<AVLSnapshotHeader>::write(out, header);
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::writeSnapshotEntry(std::ostream& out, int height, const Node<Key, Value>* node)
+{
+    Serializer<uint8_t>::write(out, (uint8_t)height);
+    Serializer<Key>::write(out, node->getKey());
+    Serializer<Value>::write(out, node->getValue());
+}
+
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::finishSnapshot(std::ofstream& out, const std::string& path, uint64_t count)
+{
+    AVLSnapshotHeader header = { {'A', 'V', 'L', 'S'}, 1, count, sizeof(Key), sizeof(Value) };
+    out.seekp(0);
+    Serializer<AVLSnapshotHeader>::write(out, header);
+    out.close();
+    if (!out) throw std::runtime_error("AVLTree::save: write failed for " + path);
+}
+
+/**
+* Rebuilds the tree in O(n) without comparisons or rotations.  Entries
+* arrive in key order with their heights, and every node is taller than
+* everything in its subtrees, so the shape is the Cartesian tree of the
+* heights: a stack holds the right spine built so far, and each new node
+* adopts the shorter nodes it pops as its left subtree.
+*/
+template<class Key, class Value, class Compare>
+void AVLTree<Key, Value, Compare>::load(const std::string& path)
+{
+    std::vector<char> buffer(1 << 20);
+    std::ifstream in;
+    in.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+    in.open(path.c_str(), std::ios::binary);
+    if (!in) throw std::runtime_error("AVLTree::load: cannot open " + path);
+
+    AVLSnapshotHeader header = Serializer<AVLSnapshotHeader>::read(in);
+    if (std::string(header.magic, 4) != "AVLS" || header.version != 1) {
+        throw std::runtime_error("AVLTree::load: " + path + " is not an AVLTree snapshot");
+    }
+    if (header.keySize != sizeof(Key) || header.valueSize != sizeof(Value)) {
+        throw std::runtime_error("AVLTree::load: key/value types of " + path + " do not match");
+    }
+
+    this->clear();
+
+    struct Spine {
+        AVLNode<Key, Value>* node;
+        int height;
+        int leftHeight;
+    };
+    Spine spine[256];
+    int depth = 0;
+    // root of everything linked so far, so a failed load can free it
+    AVLNode<Key, Value>* built = NULL;
+
+    try {
+        for (uint64_t i = 0; i <= header.count; ++i) {
+            int height = 256;
+            if (i < header.count) {
+                height = Serializer<uint8_t>::read(in);
+                if (height == 0) throw std::runtime_error("AVLTree::load: corrupt snapshot " + path);
+            }
+
+            // finish the spine nodes shorter than this one; their right
+            // subtrees are now complete
+            AVLNode<Key, Value>* left = NULL;
+            int leftHeight = 0;
+            while (depth > 0 && spine[depth - 1].height < height) {
+                Spine& done = spine[--depth];
+                int balance = leftHeight - done.leftHeight;
+                if (done.height != 1 + std::max(leftHeight, done.leftHeight) || balance < -1 || balance > 1) {
+                    throw std::runtime_error("AVLTree::load: corrupt snapshot " + path);
+                }
+                done.node->setBalance((int8_t)balance);
+                updateNode(done.node);
+                left = done.node;
+                leftHeight = done.height;
+            }
+            if (i == header.count) break;
+            if (depth == 255) throw std::runtime_error("AVLTree::load: corrupt snapshot " + path);
+
+            Key key = Serializer<Key>::read(in);
+            Value value = Serializer<Value>::read(in);
+            AVLNode<Key, Value>* node = createNode(key, value, NULL);
+            node->setLeft(left);
+            if (left != NULL) left->setParent(node);
+            if (depth > 0) {
+                spine[depth - 1].node->setRight(node);
+                node->setParent(spine[depth - 1].node);
+            } else {
+                built = node;
+            }
+            spine[depth].node = node;
+            spine[depth].height = height;
+            spine[depth].leftHeight = leftHeight;
+            ++depth;
+        }
+    } catch (...) {
+        this->root_ = built;
+        this->clear();
+        throw;
+    }
+
+    this->root_ = built;
+}
+
+#endif
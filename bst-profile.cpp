@@ -0,0 +1,91 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+// Keeps the optimizer from discarding lookups whose results are unused.
+volatile uint64_t sink;
+
+/**
+ * Runs insert, find, iterator::operator++ and remove over the given keys and
+ * prints the hardware counters per operation.
+ */
+template<typename Tree>
+void profileTree(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& lookups)
+{
+    PerfCounters counters;
+    Tree tree;
+    PerfCounters::Sample sample;
+
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    sample = counters.stop();
+    printPerOperation(cout, name + "::insert", sample, keys.size(), counters.available());
+
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) ++found;
+    }
+    sample = counters.stop();
+    sink = found;
+    printPerOperation(cout, name + "::find", sample, lookups.size(), counters.available());
+
+    uint64_t visited = 0;
+    typename Tree::iterator it = tree.begin();
+    counters.start();
+    for (; it != tree.end(); ++it) {
+        ++visited;
+    }
+    sample = counters.stop();
+    sink = visited;
+    printPerOperation(cout, name + "::iterator::operator++", sample, visited, counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        tree.remove(lookups[i]);
+    }
+    sample = counters.stop();
+    printPerOperation(cout, name + "::remove", sample, lookups.size(), counters.available());
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 100000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    // Random insertion order keeps the unbalanced BST at O(log n) expected depth
+    // so both trees can be profiled with the same key set.
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i * 2;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    vector<uint64_t> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    PerfCounters probe;
+    if (!probe.available()) {
+        cout << "Hardware counters unavailable (check /proc/sys/kernel/perf_event_paranoid);"
+             << " reporting wall time only." << endl;
+    }
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    profileTree<BinarySearchTree<uint64_t, uint64_t> >("BinarySearchTree", keys, lookups);
+    profileTree<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, lookups);
+
+    return 0;
+}
@@ -1,10 +1,1478 @@
 #include <iostream>
 #include <map>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <random>
+#include <atomic>
+#include <climits>
+#include <sstream>
+#include <stdexcept>
+#include <fstream>
+#include <csignal>
+#include <sys/resource.h>
 #include "bst.h"
+#include "rbbst.h"
+#include "splaybst.h"
 #include "avlbst.h"
+#include "compactavl.h"
+#include "pathavl.h"
+#include "fixedavl.h"
+#include "hybridmap.h"
+#include "lazyavl.h"
+#include "multimapavl.h"
+#include "parallel_walk.h"
+#include "tree_export.h"
+#include "intervaltree.h"
+#include "durableavl.h"
+#include "alloc_counter.h"
 
 using namespace std;
 
+int failures = 0;
+
+void check(bool ok, const string& what)
+{
+    if (!ok) {
+        cout << "FAILED: " << what << endl;
+        ++failures;
+    }
+}
+
+/**
+ * True iff iterating tree yields exactly the items of expected, in order.
+ */
+template<typename Tree, typename Map>
+bool sameItems(const Tree& tree, const Map& expected)
+{
+    typename Map::const_iterator want = expected.begin();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++want) {
+        if (want == expected.end() || it->first != want->first || it->second != want->second) {
+            return false;
+        }
+    }
+    return want == expected.end();
+}
+
+/**
+ * Random inserts, removes and lookups against std::map, then a save/load
+ * round trip of a tree holding tombstones.
+ */
+void testLazyAVLTree()
+{
+    mt19937 rng(36);
+    LazyAVLTree<int, int> tree(0.25);
+    map<int, int> expected;
+    for (int op = 0; op < 20000; ++op) {
+        int key = (int)(rng() % 500);
+        switch (rng() % 3) {
+        case 0:
+            tree.insert(std::make_pair(key, op));
+            expected[key] = op;
+            break;
+        case 1:
+            tree.remove(key);
+            expected.erase(key);
+            break;
+        default:
+            check(tree.contains(key) == (expected.count(key) == 1), "LazyAVLTree::contains");
+            break;
+        }
+        if (op % 1000 == 0) {
+            check(tree.size() == expected.size(), "LazyAVLTree::size");
+            check(sameItems(tree, expected), "LazyAVLTree iteration");
+            check(tree.isBalanced(), "LazyAVLTree balance");
+        }
+    }
+    check(sameItems(tree, expected), "LazyAVLTree iteration");
+
+    LazyAVLTree<int, int> saved(1.0);
+    map<int, int> live;
+    for (int key = 0; key < 10; ++key) {
+        saved.insert(std::make_pair(key, key * 10));
+        live[key] = key * 10;
+    }
+    saved.remove(3);
+    saved.remove(5);
+    live.erase(3);
+    live.erase(5);
+    check(saved.deadCount() == 2, "LazyAVLTree keeps tombstones");
+    string path = "bst-test.avls";
+    saved.save(path);
+
+    LazyAVLTree<int, int> loaded;
+    loaded.insert(std::make_pair(42, 42));
+    loaded.load(path);
+    std::remove(path.c_str());
+    check(!loaded.contains(3) && !loaded.contains(5), "LazyAVLTree::load drops tombstones");
+    check(loaded.size() == live.size() && loaded.deadCount() == 0, "LazyAVLTree::load counts");
+    check(sameItems(loaded, live), "LazyAVLTree::load contents");
+    check(loaded.isBalanced(), "LazyAVLTree::load balance");
+    loaded.remove(7);
+    live.erase(7);
+    check(loaded.size() == live.size() && sameItems(loaded, live), "LazyAVLTree remove after load");
+}
+
+
+/**
+ * True iff the multimap holds exactly the values of expected, with each
+ * key's values in insertion order.
+ */
+bool sameValues(const AVLMultiMap<int, int>& tree, const multimap<int, int>& expected)
+{
+    if (tree.size() != expected.size()) return false;
+    for (multimap<int, int>::const_iterator it = expected.begin(); it != expected.end(); ) {
+        pair<multimap<int, int>::const_iterator, multimap<int, int>::const_iterator> want =
+            expected.equal_range(it->first);
+        pair<int*, int*> got = tree.equal_range(it->first);
+        if (tree.count(it->first) != (size_t)distance(want.first, want.second)) return false;
+        for (; want.first != want.second; ++want.first, ++got.first) {
+            if (got.first == got.second || *got.first != want.first->second) return false;
+        }
+        if (got.first != got.second) return false;
+        it = want.second;
+    }
+    return true;
+}
+
+/**
+ * True iff size() matches the values actually held in the runs.
+ */
+bool sizeFollows(const AVLMultiMap<int, int>& tree)
+{
+    size_t values = 0;
+    for (AVLMultiMap<int, int>::iterator it = tree.begin(); it != tree.end(); ++it) {
+        values += it->second.size();
+    }
+    return tree.size() == values;
+}
+
+/**
+ * Random inserts and key removals against std::multimap, then a merge and
+ * a node handle moved onto an existing key.  size() must follow every
+ * change, and operator[] gives no way to change a run behind its back.
+ */
+void testAVLMultiMap()
+{
+    mt19937 rng(39);
+    AVLMultiMap<int, int> tree;
+    multimap<int, int> expected;
+    for (int op = 0; op < 20000; ++op) {
+        int key = (int)(rng() % 300);
+        if (rng() % 8 == 0) {
+            tree.remove(key);
+            expected.erase(key);
+        } else {
+            tree.insert(std::make_pair(key, op));
+            expected.insert(std::make_pair(key, op));
+        }
+    }
+    check(sameValues(tree, expected) && sizeFollows(tree), "AVLMultiMap contents");
+    check(tree.isBalanced(), "AVLMultiMap balance");
+    static_assert(std::is_const<std::remove_reference<decltype(tree[1])>::type>::value,
+                  "AVLMultiMap::operator[] must not hand out a mutable run");
+
+    AVLMultiMap<int, int> other;
+    for (int op = 0; op < 5000; ++op) {
+        int key = (int)(rng() % 600);
+        other.insert(std::make_pair(key, -op));
+        expected.insert(std::make_pair(key, -op));
+    }
+    tree.merge(std::move(other));
+    check(other.empty() && sameValues(tree, expected) && sizeFollows(tree), "AVLMultiMap::merge");
+    check(tree.isBalanced(), "AVLMultiMap::merge balance");
+
+    AVLMultiMap<int, int>::NodeHandle handle = tree.extract(7);
+    check(!handle.empty() && tree.count(7) == 0, "AVLMultiMap::extract");
+    handle.value().push_back(70);
+    expected.insert(std::make_pair(7, 70));
+    tree.insert(std::move(handle));
+    check(handle.empty() && sameValues(tree, expected) && sizeFollows(tree),
+          "AVLMultiMap::insert(NodeHandle) of a new key");
+
+    AVLMultiMap<int, int> spare;
+    spare.insert(std::make_pair(7, 100));
+    spare.insert(std::make_pair(7, 101));
+    handle = spare.extract(7);
+    handle.value().push_back(102);
+    tree.insert(std::move(handle));
+    expected.insert(std::make_pair(7, 100));
+    expected.insert(std::make_pair(7, 101));
+    expected.insert(std::make_pair(7, 102));
+    check(spare.empty() && sameValues(tree, expected) && sizeFollows(tree),
+          "AVLMultiMap::insert(NodeHandle) onto a present key");
+
+    AVLMultiMap<int, int> small;
+    small.insert(std::make_pair(1, 1));
+    small.insert(std::make_pair(1, 2));
+    small.insert(std::make_pair(1, 3));
+    check(small[1].size() == 3 && small.count(1) == 3 && small.size() == 3 && sizeFollows(small),
+          "AVLMultiMap size after adding to a key");
+    small.erase(small.find(1));
+    check(small.size() == 0 && small.count(1) == 0 && sizeFollows(small), "AVLMultiMap size after erase");
+}
+
+/**
+ * The keys seen by a stretch of a walk: empty, in order from lo to hi, or
+ * out of order.  Combining stretches is associative but not commutative.
+ */
+struct KeySpan
+{
+    int lo;
+    int hi;
+    bool empty;
+    bool ordered;
+};
+
+KeySpan joinSpans(const KeySpan& a, const KeySpan& b)
+{
+    if (a.empty) return b;
+    if (b.empty) return a;
+    KeySpan joined = { a.lo, b.hi, false, a.ordered && b.ordered && a.hi < b.lo };
+    return joined;
+}
+
+/**
+ * parallelReduce must combine in key order and both walks must skip
+ * LazyAVLTree's tombstones, on balanced and unbalanced trees alike.
+ */
+void testParallelWalk()
+{
+    mt19937 rng(40);
+    const KeySpan none = { 0, 0, true, true };
+    auto span = [](const std::pair<const int, int>& item) {
+        KeySpan one = { item.first, item.first, false, true };
+        return one;
+    };
+    auto sum = [](const std::pair<const int, int>& item) { return (long)item.second; };
+    auto plus = [](long a, long b) { return a + b; };
+
+    LazyAVLTree<int, int> lazy(1.0);
+    BinarySearchTree<int, int> bst;
+    long liveSum = 0;
+    size_t live = 0;
+    for (int key = 0; key < (1 << 16); ++key) {
+        lazy.insert(std::make_pair(key, key));
+        bst.insert(std::make_pair((int)(rng() % 1000000), 1));
+    }
+    for (int key = 0; key < (1 << 16); ++key) {
+        if (rng() % 4 == 0) {
+            lazy.remove(key);
+        } else {
+            liveSum += key;
+            ++live;
+        }
+    }
+
+    for (size_t threads = 1; threads <= 4; threads *= 2) {
+        KeySpan lazySpan = parallelReduce(lazy, none, span, joinSpans, threads);
+        check(lazySpan.ordered, "parallelReduce key order on LazyAVLTree");
+        check(parallelReduce(lazy, 0L, sum, plus, threads) == liveSum, "parallelReduce skips tombstones");
+        std::atomic<size_t> visited(0);
+        parallelForEach(lazy, [&visited](std::pair<const int, int>&) { ++visited; }, threads);
+        check(visited == live, "parallelForEach skips tombstones");
+
+        KeySpan bstSpan = parallelReduce(bst, none, span, joinSpans, threads);
+        long bstSize = 0;
+        for (BinarySearchTree<int, int>::iterator it = bst.begin(); it != bst.end(); ++it) {
+            ++bstSize;
+        }
+        check(bstSpan.ordered, "parallelReduce key order on BinarySearchTree");
+        check(parallelReduce(bst, 0L, sum, plus, threads) == bstSize, "parallelReduce on BinarySearchTree");
+    }
+}
+
+/**
+ * A LazyAVLTree built in bulk, so its counting createNode runs on the
+ * build's worker threads.
+ */
+class BulkLazyTree : public LazyAVLTree<int, int>
+{
+public:
+    BulkLazyTree(std::vector<std::pair<int, int> > items, size_t threads)
+    {
+        this->buildFromUnsorted(items, threads);
+    }
+};
+
+/**
+ * The bulk constructor against inserting the same items into std::map one
+ * by one, on enough items that the build runs on the pool.
+ */
+void testBulkBuild()
+{
+    mt19937 rng(41);
+    vector<pair<int, int> > items;
+    map<int, int> expected;
+    for (int i = 0; i < 40000; ++i) {
+        int key = (int)(rng() % 30000);
+        items.push_back(std::make_pair(key, i));
+        expected[key] = i;
+    }
+
+    for (size_t threads = 1; threads <= 4; threads *= 2) {
+        AVLTree<int, int> tree(items, threads);
+        check(sameItems(tree, expected), "AVLTree bulk build, last duplicate wins");
+        check(tree.isBalanced(), "AVLTree bulk build balance");
+
+        BulkLazyTree lazy(items, threads);
+        check(lazy.size() == expected.size() && sameItems(lazy, expected), "LazyAVLTree bulk build");
+        lazy.remove(items[0].first);
+        check(lazy.size() == expected.size() - 1, "LazyAVLTree bulk build counts");
+    }
+}
+
+/**
+ * Merges of random trees against the same merge of std::maps, with other
+ * both about as big as this tree (linked into a new tree) and much smaller
+ * (inserted node by node), under each way of resolving equal keys.
+ */
+void testMerge()
+{
+    mt19937 rng(49);
+    const size_t sizes[] = { 2000, 700, 20, 0 };
+    for (int round = 0; round < 24; ++round) {
+        size_t otherSize = sizes[round % 4];
+        int how = round / 4 % 3;  // 0: KEEP_OURS, 1: TAKE_THEIRS, 2: sum
+        AVLTree<int, int> tree;
+        AVLTree<int, int> other;
+        map<int, int> expected;
+        map<int, int> theirs;
+        for (int i = 0; i < 2000; ++i) {
+            int key = (int)(rng() % 4000);
+            tree.insert(std::make_pair(key, i));
+            expected[key] = i;
+        }
+        for (size_t i = 0; i < otherSize; ++i) {
+            int key = (int)(rng() % 4000);
+            other.insert(std::make_pair(key, -(int)i));
+            theirs[key] = -(int)i;
+        }
+        for (map<int, int>::iterator it = theirs.begin(); it != theirs.end(); ++it) {
+            map<int, int>::iterator ours = expected.find(it->first);
+            if (ours == expected.end()) {
+                expected.insert(*it);
+            } else if (how == 1) {
+                ours->second = it->second;
+            } else if (how == 2) {
+                ours->second += it->second;
+            }
+        }
+
+        if (how == 2) {
+            tree.merge(std::move(other), [](int ours, int theirs) { return ours + theirs; });
+        } else {
+            tree.merge(std::move(other), how == 0 ? AVLTree<int, int>::KEEP_OURS : AVLTree<int, int>::TAKE_THEIRS);
+        }
+        check(sameItems(tree, expected), "AVLTree::merge items");
+        check(tree.isBalanced(), "AVLTree::merge balance");
+        check(other.begin() == other.end(), "AVLTree::merge empties other");
+    }
+
+    // a throwing combine loses only other's items not yet moved
+    for (int small = 0; small < 2; ++small) {
+        for (int throwAt = 0; throwAt < 3; ++throwAt) {
+            AVLTree<int, int> tree;
+            AVLTree<int, int> other;
+            map<int, int> original;
+            for (int i = 0; i < 1000; ++i) {
+                tree.insert(std::make_pair(2 * i, i));
+                original[2 * i] = i;
+            }
+            // odd keys are other's alone, even ones are combined
+            int otherSize = small ? 30 : 1000;
+            for (int i = 0; i < otherSize; ++i) other.insert(std::make_pair(i, -i));
+            int calls = 0;
+            int limit = throwAt * otherSize / 6;
+            bool threw = false;
+            try {
+                tree.merge(std::move(other), [&calls, limit](int ours, int theirs) {
+                    if (calls++ == limit) throw std::runtime_error("combine");
+                    return ours + theirs;
+                });
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            check(threw, "AVLTree::merge passes on combine's exception");
+            check(other.begin() == other.end(), "AVLTree::merge empties other on an exception");
+            check(tree.isBalanced(), "AVLTree::merge balance after an exception");
+
+            // every key of this tree stays, either untouched or combined before
+            // the throw; any odd key is one of other's moved in before it
+            bool kept = true;
+            size_t keys = 0;
+            for (AVLTree<int, int>::iterator it = tree.begin(); it != tree.end(); ++it, ++keys) {
+                map<int, int>::const_iterator was = original.find(it->first);
+                if (was == original.end()) {
+                    kept &= it->first % 2 == 1 && it->first < otherSize && it->second == -it->first;
+                } else {
+                    kept &= it->second == was->second || it->second == was->second - it->first;
+                }
+            }
+            for (map<int, int>::const_iterator it = original.begin(); it != original.end(); ++it) {
+                kept &= tree.find(it->first) != tree.end();
+            }
+            check(kept && keys >= original.size(), "AVLTree::merge keeps this tree's items on an exception");
+        }
+    }
+
+    // the count a LazyAVLTree keeps covers the items moved in before a throw
+    LazyAVLTree<int, int> lazyTree;
+    LazyAVLTree<int, int> lazyOther;
+    for (int i = 0; i < 1000; ++i) lazyTree.insert(std::make_pair(2 * i, i));
+    for (int i = 0; i < 1000; ++i) lazyOther.insert(std::make_pair(i, i));
+    try {
+        lazyTree.merge(std::move(lazyOther), [](int ours, int theirs) {
+            if (ours == 300) throw std::runtime_error("combine");
+            return ours + theirs;
+        });
+    } catch (const std::runtime_error&) {
+    }
+    size_t lazyItems = 0;
+    for (LazyAVLTree<int, int>::iterator it = lazyTree.begin(); it != lazyTree.end(); ++it) ++lazyItems;
+    check(lazyTree.size() == lazyItems && lazyItems == 1000 + 300 && lazyOther.size() == 0,
+          "LazyAVLTree::merge counts the items moved in before an exception");
+
+    AVLTree<int, int> tree;
+    LazyAVLTree<int, int> lazy;
+    lazy.insert(std::make_pair(1, 1));
+    bool threw = false;
+    try {
+        tree.merge(std::move(lazy));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "AVLTree::merge rejects a tree of another type");
+}
+
+/**
+ * Random moves of nodes between two trees through extract and insert
+ * against the same moves between two std::maps, including handles landing
+ * on a key the target already holds.
+ */
+void testExtractInsert()
+{
+    mt19937 rng(50);
+    AVLTree<int, int> trees[2];
+    map<int, int> expected[2];
+    for (int i = 0; i < 3000; ++i) {
+        int side = (int)(rng() % 2);
+        int key = (int)(rng() % 2000);
+        trees[side].insert(std::make_pair(key, i));
+        expected[side][key] = i;
+    }
+    for (int i = 0; i < 6000; ++i) {
+        int from = (int)(rng() % 2);
+        int key = (int)(rng() % 2000);
+        AVLTree<int, int>::NodeHandle handle = trees[from].extract(key);
+        map<int, int>::iterator want = expected[from].find(key);
+        if (want == expected[from].end()) {
+            check(handle.empty(), "AVLTree::extract of a missing key");
+            check(trees[1 - from].insert(std::move(handle)) == trees[1 - from].end(),
+                  "AVLTree::insert of an empty handle");
+            continue;
+        }
+        check(!handle.empty() && handle.key() == key && handle.value() == want->second,
+              "AVLTree::extract hands over the item");
+        handle.value() = i;
+        expected[1 - from][key] = i;
+        expected[from].erase(want);
+        AVLTree<int, int>::iterator it = trees[1 - from].insert(std::move(handle));
+        check(handle.empty() && it != trees[1 - from].end() && it->first == key && it->second == i,
+              "AVLTree::insert of a handle");
+    }
+    for (int side = 0; side < 2; ++side) {
+        check(sameItems(trees[side], expected[side]), "AVLTree extract/insert items");
+        check(trees[side].isBalanced(), "AVLTree extract/insert balance");
+    }
+
+    // a handle only goes back into the type of tree it came from
+    LazyAVLTree<int, int> lazy;
+    AVLTree<int, int>::NodeHandle handle = trees[0].extract(trees[0].begin());
+    int key = handle.key();
+    bool threw = false;
+    try {
+        lazy.insert(std::move(handle));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw && !handle.empty() && handle.key() == key, "LazyAVLTree::insert rejects a foreign handle");
+    trees[0].insert(std::move(handle));
+    check(trees[0].find(key) != trees[0].end(), "AVLTree::insert takes a rejected handle back");
+
+    // the maximum end points follow a node moved between interval trees
+    IntervalTree<int, int> source;
+    IntervalTree<int, int> target;
+    for (int i = 0; i < 100; ++i) {
+        Interval<int> interval = { i, i + 1 };
+        (i % 2 == 0 ? source : target).insert(std::make_pair(interval, i));
+    }
+    Interval<int> wide = { 1000, 5000 };
+    source.insert(std::make_pair(wide, -1));
+    target.insert(source.extract(wide));
+    check(source.stabbing(3000).empty(), "IntervalTree::extract updates the maxima");
+    check(target.stabbing(3000).size() == 1, "IntervalTree::insert of a handle updates the maxima");
+}
+
+/**
+ * Random inserts, removes and lookups against std::map, checking the
+ * red-black invariants as it goes, then ascending inserts and removing
+ * every key again.
+ */
+/**
+ * A tree that also lists its keys in pre-order.  Together with the
+ * in-order walk that pins down the shape, so a copy can be checked to be
+ * the same tree rather than just the same items.
+ */
+template<typename Tree, typename Key = int>
+class ShapeProbe : public Tree
+{
+public:
+    using Tree::Tree;
+
+    vector<Key> preOrder() const
+    {
+        vector<Key> keys;
+        vector<Node<Key, int>*> pending;
+        if (this->root_ != NULL) pending.push_back(this->root_);
+        while (!pending.empty()) {
+            Node<Key, int>* node = pending.back();
+            pending.pop_back();
+            keys.push_back(node->getKey());
+            if (node->getRight() != NULL) pending.push_back(node->getRight());
+            if (node->getLeft() != NULL) pending.push_back(node->getLeft());
+        }
+        return keys;
+    }
+
+    vector<pair<Key, int> > items() const
+    {
+        vector<pair<Key, int> > items;
+        for (typename Tree::iterator it = this->begin(); it != this->end(); ++it) {
+            items.push_back(make_pair(it->first, it->second));
+        }
+        return items;
+    }
+};
+
+template<typename Probe>
+bool sameShape(const Probe& lhs, const Probe& rhs)
+{
+    return lhs.preOrder() == rhs.preOrder() && lhs.items() == rhs.items();
+}
+
+/**
+ * Copies keep the shape and are independent of their source; self
+ * assignment changes nothing; a moved-from tree is empty and usable.
+ */
+template<typename Tree>
+void testCopyMoveTree(const string& name)
+{
+    typedef ShapeProbe<Tree> Probe;
+    mt19937 rng(48);
+    Probe tree;
+    for (int i = 0; i < 500; ++i) tree.insert(std::make_pair((int)(rng() % 2000), i));
+    for (int i = 0; i < 100; ++i) tree.remove((int)(rng() % 2000));
+    const vector<int> shape = tree.preOrder();
+    const vector<pair<int, int> > items = tree.items();
+
+    Probe copy(tree);
+    check(sameShape(copy, tree), name + " copy constructor keeps the shape");
+    Probe assigned;
+    assigned.insert(std::make_pair(-1, -1));
+    assigned = tree;
+    check(sameShape(assigned, tree), name + " copy assignment keeps the shape");
+
+    for (int i = 0; i < 200; ++i) tree.insert(std::make_pair((int)(rng() % 2000), -i));
+    for (int i = 0; i < 200; ++i) tree.remove((int)(rng() % 2000));
+    check(copy.preOrder() == shape && copy.items() == items, name + " copy is independent of its source");
+    for (int i = 0; i < 200; ++i) copy.remove((int)(rng() % 2000));
+    copy.clear();
+    check(assigned.preOrder() == shape && assigned.items() == items, name + " copies are independent of each other");
+
+    Probe& alias = assigned;
+    assigned = alias;
+    check(assigned.preOrder() == shape && assigned.items() == items, name + " self copy assignment");
+    assigned = std::move(alias);
+    check(assigned.preOrder() == shape && assigned.items() == items, name + " self move assignment");
+
+    Probe moved(std::move(assigned));
+    check(moved.preOrder() == shape && moved.items() == items, name + " move constructor takes the nodes");
+    check(assigned.empty() && assigned.begin() == assigned.end(), name + " moved-from tree is empty");
+    assigned.insert(std::make_pair(7, 7));
+    check(assigned.find(7) != assigned.end() && assigned.preOrder() == vector<int>(1, 7),
+          name + " moved-from tree is reusable");
+
+    Probe target;
+    target.insert(std::make_pair(-1, -1));
+    target = std::move(moved);
+    check(target.preOrder() == shape && target.items() == items, name + " move assignment takes the nodes");
+    check(moved.empty(), name + " move assignment empties its source");
+    moved.insert(std::make_pair(3, 3));
+    check(moved.find(3) != moved.end() && moved.find(-1) == moved.end(), name + " moved-from tree is reusable");
+}
+
+/**
+ * Copies of the trees that keep more than a key and value per node: the
+ * counts of a LazyAVLTree, and the node subclasses of a RedBlackTree and
+ * an IntervalTree, whose invariants need the colors and maxima copied.
+ */
+void testCopyMove()
+{
+    testCopyMoveTree<BinarySearchTree<int, int> >("BinarySearchTree");
+    testCopyMoveTree<AVLTree<int, int> >("AVLTree");
+    testCopyMoveTree<LazyAVLTree<int, int> >("LazyAVLTree");
+    testCopyMoveTree<RedBlackTree<int, int> >("RedBlackTree");
+
+    LazyAVLTree<int, int> lazy(1.0);
+    for (int key = 0; key < 100; ++key) lazy.insert(std::make_pair(key, key));
+    for (int key = 0; key < 100; key += 3) lazy.remove(key);
+    size_t live = lazy.size();
+    size_t dead = lazy.deadCount();
+    LazyAVLTree<int, int> lazyCopy(lazy);
+    check(lazyCopy.size() == live && lazyCopy.deadCount() == dead, "LazyAVLTree copy keeps the counts");
+    LazyAVLTree<int, int> lazyAssigned;
+    lazyAssigned.insert(std::make_pair(500, 500));
+    lazyAssigned = lazy;
+    check(lazyAssigned.size() == live && lazyAssigned.deadCount() == dead,
+          "LazyAVLTree copy assignment keeps the counts");
+    lazyCopy.remove(1);
+    check(lazyCopy.size() == live - 1 && lazy.size() == live && lazy.deadCount() == dead,
+          "LazyAVLTree copy counts are its own");
+    LazyAVLTree<int, int> lazyMoved(std::move(lazyAssigned));
+    check(lazyMoved.size() == live && lazyMoved.deadCount() == dead, "LazyAVLTree move keeps the counts");
+    check(lazyAssigned.size() == 0 && lazyAssigned.deadCount() == 0, "LazyAVLTree move empties the counts");
+    lazyAssigned.insert(std::make_pair(1, 1));
+    check(lazyAssigned.size() == 1 && lazyAssigned.contains(1), "LazyAVLTree moved-from tree is reusable");
+    lazyAssigned = std::move(lazyMoved);
+    check(lazyAssigned.size() == live && lazyAssigned.deadCount() == dead,
+          "LazyAVLTree move assignment keeps the counts");
+
+    mt19937 rng(48);
+    RedBlackTree<int, int> redBlack;
+    for (int i = 0; i < 2000; ++i) redBlack.insert(std::make_pair((int)(rng() % 5000), i));
+    RedBlackTree<int, int> redBlackCopy(redBlack);
+    check(redBlackCopy.isValidRedBlack(), "RedBlackTree copy keeps the colors");
+    for (int i = 0; i < 2000; ++i) {
+        redBlackCopy.insert(std::make_pair((int)(rng() % 5000), i));
+        redBlackCopy.remove((int)(rng() % 5000));
+    }
+    check(redBlackCopy.isValidRedBlack() && redBlack.isValidRedBlack(), "RedBlackTree copy stays red-black");
+    redBlack = redBlackCopy;
+    check(redBlack.isValidRedBlack(), "RedBlackTree copy assignment keeps the colors");
+
+    IntervalTree<int, int> intervals;
+    for (int i = 0; i < 500; ++i) {
+        int low = (int)(rng() % 10000);
+        Interval<int> interval = { low, low + (int)(rng() % 500) };
+        intervals.insert(std::make_pair(interval, i));
+    }
+    IntervalTree<int, int> intervalsCopy(intervals);
+    check(intervalsCopy.isValidMaxHigh(), "IntervalTree copy keeps the maxima");
+    bool sameStabs = true;
+    for (int point = 0; point < 10500; point += 37) {
+        sameStabs &= intervalsCopy.stabbing(point).size() == intervals.stabbing(point).size();
+    }
+    check(sameStabs, "IntervalTree copy answers the same queries");
+    for (int i = 0; i < 500; ++i) {
+        Interval<int> interval = { i * 20, i * 20 + 1000 };
+        intervalsCopy.insert(std::make_pair(interval, -i));
+    }
+    check(intervalsCopy.isValidMaxHigh() && intervals.isValidMaxHigh(), "IntervalTree copy stays valid");
+    intervals = intervalsCopy;
+    check(intervals.isValidMaxHigh(), "IntervalTree copy assignment keeps the maxima");
+}
+
+void testRedBlackTree()
+{
+    mt19937 rng(34);
+    RedBlackTree<int, int> tree;
+    map<int, int> expected;
+    for (int op = 0; op < 20000; ++op) {
+        int key = (int)(rng() % 600);
+        switch (rng() % 3) {
+        case 0:
+            tree.insert(std::make_pair(key, op));
+            expected[key] = op;
+            break;
+        case 1:
+            tree.remove(key);
+            expected.erase(key);
+            break;
+        default:
+            check((tree.find(key) != tree.end()) == (expected.count(key) == 1), "RedBlackTree::find");
+            break;
+        }
+        if (op % 500 == 0) {
+            check(tree.isValidRedBlack(), "RedBlackTree invariants");
+            check(sameItems(tree, expected), "RedBlackTree iteration");
+        }
+    }
+    check(tree.isValidRedBlack() && sameItems(tree, expected), "RedBlackTree after random operations");
+
+    RedBlackTree<int, int> sorted;
+    for (int key = 0; key < 5000; ++key) sorted.insert(std::make_pair(key, key));
+    check(sorted.isValidRedBlack(), "RedBlackTree ascending inserts");
+    for (int key = 0; key < 5000; key += 2) sorted.remove(key);
+    check(sorted.isValidRedBlack(), "RedBlackTree removes");
+    for (int key = 1; key < 5000; key += 2) sorted.remove(key);
+    check(sorted.empty() && sorted.isValidRedBlack(), "RedBlackTree removes every key");
+}
+
+/**
+ * A SplayTree that shows enough of its shape to check where splaying put
+ * a node and that every parent pointer matches its child pointers.
+ */
+class SplayProbe : public SplayTree<int, int>
+{
+public:
+    SplayProbe(SplayMode mode, size_t minSplayDepth) : SplayTree<int, int>(mode, minSplayDepth) {}
+
+    int rootKey() const { return this->root_ == NULL ? -1 : this->root_->getKey(); }
+
+    int depthOf(int key) const
+    {
+        int depth = 0;
+        for (Node<int, int>* node = this->root_; node != NULL; ++depth) {
+            if (key == node->getKey()) return depth;
+            node = key < node->getKey() ? node->getLeft() : node->getRight();
+        }
+        return -1;
+    }
+
+    bool linked() const
+    {
+        if (this->root_ != NULL && this->root_->getParent() != NULL) return false;
+        vector<Node<int, int>*> pending;
+        if (this->root_ != NULL) pending.push_back(this->root_);
+        while (!pending.empty()) {
+            Node<int, int>* node = pending.back();
+            pending.pop_back();
+            Node<int, int>* children[2] = { node->getLeft(), node->getRight() };
+            for (int i = 0; i < 2; ++i) {
+                if (children[i] == NULL) continue;
+                if (children[i]->getParent() != node) return false;
+                pending.push_back(children[i]);
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * Random inserts, removes and finds in both splay modes against std::map.
+ * A full splay brings the found key to the root, a semi-splay never moves
+ * it down, and neither touches a key found within minSplayDepth.
+ */
+void testSplayTree()
+{
+    mt19937 rng(35);
+    for (int semi = 0; semi < 2; ++semi) {
+        SplayProbe tree(semi ? SplayProbe::SEMI_SPLAY : SplayProbe::FULL_SPLAY, 0);
+        map<int, int> expected;
+        for (int op = 0; op < 20000; ++op) {
+            int key = (int)(rng() % 600);
+            switch (rng() % 3) {
+            case 0:
+                tree.insert(std::make_pair(key, op));
+                expected[key] = op;
+                break;
+            case 1:
+                tree.remove(key);
+                expected.erase(key);
+                break;
+            default: {
+                int before = tree.depthOf(key);
+                bool found = tree.find(key) != tree.end();
+                check(found == (expected.count(key) == 1), "SplayTree::find");
+                if (found && !semi) check(tree.rootKey() == key, "SplayTree::find splays to the root");
+                if (found && semi) check(tree.depthOf(key) <= before, "SplayTree::find semi-splays up");
+                break;
+            }
+            }
+            if (op % 500 == 0) {
+                check(tree.linked(), "SplayTree parent pointers");
+                check(sameItems(tree, expected), "SplayTree iteration");
+            }
+        }
+        check(tree.linked() && sameItems(tree, expected), "SplayTree after random operations");
+    }
+
+    SplayProbe shallow(SplayProbe::FULL_SPLAY, 3);
+    for (int key = 0; key < 100; ++key) shallow.insert(std::make_pair(key, key));
+    int root = shallow.rootKey();
+    int deepest = 0;
+    for (int key = 0; key < 100; ++key) {
+        if (shallow.depthOf(key) > shallow.depthOf(deepest)) deepest = key;
+        if (shallow.depthOf(key) > 3) continue;
+        shallow.find(key);
+        check(shallow.rootKey() == root, "SplayTree leaves keys within minSplayDepth alone");
+    }
+    check(shallow.depthOf(deepest) > 3, "SplayTree minSplayDepth test needs a deep key");
+    shallow.find(deepest);
+    check(shallow.rootKey() == deepest && shallow.linked(), "SplayTree splays keys below minSplayDepth");
+}
+
+/**
+ * Sampling keeps every sampleEvery-th subtree at sampleDepth, and without a
+ * sampleDepth there is nothing to sample, which is rejected.
+ */
+void testTreeExport()
+{
+    AVLTree<int, int> tree;
+    for (int i = 0; i < 15; ++i) tree.insert(std::make_pair(i, i));
+
+    TreeExportOptions options;
+    options.sampleDepth = 2;
+    options.sampleEvery = 2;
+    ostringstream json;
+    exportJson(tree, json, options);
+    size_t elided = 0;
+    for (size_t at = json.str().find("elided"); at != string::npos; at = json.str().find("elided", at + 1)) {
+        ++elided;
+    }
+    check(elided == 2, "exportJson samples every other subtree at depth 2");
+
+    options.sampleDepth = 0;
+    bool threw = false;
+    try {
+        ostringstream out;
+        exportDot(tree, out, options);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "export rejects sampleEvery > 1 with sampleDepth 0");
+}
+
+// Calls made by CountingThreeWay since the last reset.
+size_t threeWayCalls = 0;
+
+struct CountingThreeWay
+{
+    int operator()(const string& lhs, const string& rhs) const
+    {
+        ++threeWayCalls;
+        return lhs.compare(rhs);
+    }
+};
+
+/**
+ * Number of nodes a search for key visits in a tree of Nodes: the levels
+ * down to the node holding key, or to the bottom on a miss.
+ */
+template<typename Tree>
+class NodeSearchPath : public Tree
+{
+public:
+    size_t searchPath(const string& key) const
+    {
+        size_t levels = 0;
+        for (Node<string, int>* node = this->root_; node != NULL; ) {
+            ++levels;
+            int order = key.compare(node->getKey());
+            if (order == 0) break;
+            node = order < 0 ? node->getLeft() : node->getRight();
+        }
+        return levels;
+    }
+};
+
+class CompactSearchPath : public CompactAVLTree<string, int, CountingThreeWay>
+{
+public:
+    size_t searchPath(const string& key) const
+    {
+        size_t levels = 0;
+        for (uint32_t i = this->storage_.header().root; i != 0; ) {
+            ++levels;
+            int order = key.compare(this->keyOf(i));
+            if (order == 0) break;
+            i = order < 0 ? this->left(i) : this->right(i);
+        }
+        return levels;
+    }
+};
+
+class PathSearchPath : public PathAVLTree<string, int, CountingThreeWay>
+{
+public:
+    size_t searchPath(const string& key) const
+    {
+        size_t levels = 0;
+        for (PathNode* node = this->root_; node != NULL; ) {
+            ++levels;
+            int order = key.compare(node->item.first);
+            if (order == 0) break;
+            node = order < 0 ? node->left : node->right;
+        }
+        return levels;
+    }
+};
+
+/**
+ * Random inserts, removes, lookups and bounds through a three-way
+ * comparator against std::map, and a lookup making exactly one comparison
+ * per level it visits.
+ */
+template<typename Tree>
+void testThreeWayTree(const string& name, bool balancing)
+{
+    mt19937 rng(27);
+    Tree tree;
+    map<string, int> expected;
+    for (int op = 0; op < 8000; ++op) {
+        string key = "k" + to_string(rng() % 400);
+        switch (rng() % 4) {
+        case 0:
+            tree.insert(std::make_pair(key, op));
+            expected[key] = op;
+            break;
+        case 1:
+            tree.remove(key);
+            expected.erase(key);
+            break;
+        case 2: {
+            size_t levels = tree.searchPath(key);
+            threeWayCalls = 0;
+            bool found = tree.contains(key);
+            check(found == (expected.count(key) == 1), name + "::contains with a three-way comparator");
+            check(threeWayCalls == levels, name + " makes one three-way comparison per level");
+            check((tree.find(key) != tree.end()) == found, name + "::find with a three-way comparator");
+            break;
+        }
+        default: {
+            map<string, int>::iterator lower = expected.lower_bound(key);
+            map<string, int>::iterator upper = expected.upper_bound(key);
+            typename Tree::iterator gotLower = tree.lower_bound(key);
+            typename Tree::iterator gotUpper = tree.upper_bound(key);
+            check(lower == expected.end() ? gotLower == tree.end()
+                                          : gotLower != tree.end() && gotLower->first == lower->first,
+                  name + "::lower_bound with a three-way comparator");
+            check(upper == expected.end() ? gotUpper == tree.end()
+                                          : gotUpper != tree.end() && gotUpper->first == upper->first,
+                  name + "::upper_bound with a three-way comparator");
+            break;
+        }
+        }
+        if (op % 500 == 0) {
+            check(sameItems(tree, expected), name + " iteration with a three-way comparator");
+            check(!balancing || tree.isBalanced(), name + " balance with a three-way comparator");
+        }
+    }
+    check(sameItems(tree, expected), name + " iteration with a three-way comparator");
+}
+
+void testThreeWayCompare()
+{
+    testThreeWayTree<NodeSearchPath<BinarySearchTree<string, int, CountingThreeWay> > >("BinarySearchTree", false);
+    testThreeWayTree<NodeSearchPath<AVLTree<string, int, CountingThreeWay> > >("AVLTree", true);
+    testThreeWayTree<CompactSearchPath>("CompactAVLTree", true);
+    testThreeWayTree<PathSearchPath>("PathAVLTree", true);
+}
+
+/**
+ * A CompactAVLTree that shows its slot bookkeeping and checks every packed
+ * parent index and balance against the actual links and heights.
+ */
+template<typename Index>
+class CompactProbe : public CompactAVLTree<int, int, std::less<int>, Index>
+{
+public:
+    size_t slotsUsed() const { return this->storage_.header().used; }
+
+    bool consistent() const
+    {
+        Index root = this->storage_.header().root;
+        return root == 0 || (this->parent(root) == 0 && height(root) >= 0);
+    }
+
+private:
+    // Height of the subtree at i, or -1 if a link or balance is wrong.
+    int height(Index i) const
+    {
+        if (i == 0) return 0;
+        Index children[2] = { this->left(i), this->right(i) };
+        int heights[2];
+        for (int c = 0; c < 2; ++c) {
+            if (children[c] != 0 && this->parent(children[c]) != i) return -1;
+            heights[c] = height(children[c]);
+            if (heights[c] < 0) return -1;
+        }
+        if (this->balance(i) != heights[1] - heights[0]) return -1;
+        return 1 + std::max(heights[0], heights[1]);
+    }
+};
+
+/**
+ * Random inserts and removes against std::map in batches, checking balance
+ * and the packed links after each, then clear and reuse, free slots reused
+ * before the array grows, and the index type's size limit.
+ */
+template<typename Index>
+void testCompactTree(const string& name)
+{
+    mt19937 rng(29);
+    CompactProbe<Index> tree;
+    map<int, int> expected;
+    for (int round = 0; round < 2; ++round) {
+        for (int batch = 0; batch < 40; ++batch) {
+            for (int op = 0; op < 250; ++op) {
+                int key = (int)(rng() % 1500);
+                if (rng() % 3 != 0) {
+                    tree.insert(std::make_pair(key, op));
+                    expected[key] = op;
+                } else {
+                    tree.remove(key);
+                    expected.erase(key);
+                }
+            }
+            check(tree.size() == expected.size() && sameItems(tree, expected), name + " items");
+            check(tree.isBalanced() && tree.consistent(), name + " balance and links");
+        }
+        tree.clear();
+        expected.clear();
+        check(tree.empty() && tree.size() == 0 && tree.begin() == tree.end() && tree.slotsUsed() == 0,
+              name + "::clear");
+    }
+
+    for (int key = 0; key < 1000; ++key) tree.insert(std::make_pair(key, key));
+    for (int key = 0; key < 1000; key += 3) tree.remove(key);
+    size_t used = tree.slotsUsed();
+    for (int key = 0; key < 1000; key += 3) tree.insert(std::make_pair(key, -key));
+    check(tree.slotsUsed() == used && tree.size() == 1000, name + " reuses freed slots");
+    check(tree.isBalanced() && tree.consistent(), name + " balance after reusing slots");
+    check(tree.find(3) != tree.end() && tree.find(3)->second == -3, name + " items in reused slots");
+
+    bool threw = false;
+    try {
+        tree.reserve(CompactProbe<Index>::maxSize() + 1);
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    check(threw && tree.size() == 1000, name + "::reserve past maxSize throws std::length_error");
+}
+
+void testCompactAVLTree()
+{
+    testCompactTree<uint32_t>("CompactAVLTree<uint32_t>");
+    testCompactTree<uint16_t>("CompactAVLTree<uint16_t>");
+
+    // a uint16_t index addresses 2^14 items, and the next insert fails
+    // without touching the tree
+    CompactProbe<uint16_t> full;
+    size_t limit = CompactProbe<uint16_t>::maxSize();
+    for (size_t key = 0; key < limit; ++key) full.insert(std::make_pair((int)key, 0));
+    bool threw = false;
+    try {
+        full.insert(std::make_pair((int)limit, 0));
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    check(threw && full.size() == limit && !full.contains((int)limit),
+          "CompactAVLTree<uint16_t> insert past maxSize throws std::length_error");
+    check(full.isBalanced() && full.consistent(), "CompactAVLTree<uint16_t> full tree");
+}
+
+/**
+ * A PathAVLTree that tells whether the node holding a key has two
+ * children, so the test knows its removes relink predecessors.
+ */
+class PathProbe : public PathAVLTree<int, int>
+{
+public:
+    bool hasTwoChildren(int key) const
+    {
+        PathNode* node = this->internalFind(key);
+        return node != NULL && node->left != NULL && node->right != NULL;
+    }
+};
+
+/**
+ * Random inserts and removes against std::map in batches.  After each
+ * batch it checks balance, the items, and every lower_bound and
+ * upper_bound, which build iterator stacks of their own, walked to the end.
+ */
+void testPathAVLTree()
+{
+    mt19937 rng(30);
+    PathProbe tree;
+    map<int, int> expected;
+    size_t twoChildRemoves = 0;
+    for (int batch = 0; batch < 60; ++batch) {
+        for (int op = 0; op < 300; ++op) {
+            int key = (int)(rng() % 1200);
+            if (rng() % 2 == 0) {
+                tree.insert(std::make_pair(key, op));
+                expected[key] = op;
+            } else {
+                if (tree.hasTwoChildren(key)) ++twoChildRemoves;
+                tree.remove(key);
+                expected.erase(key);
+            }
+        }
+        check(tree.isBalanced(), "PathAVLTree balance");
+        check(sameItems(tree, expected), "PathAVLTree iteration");
+        for (int key = -1; key <= 1200; key += 7) {
+            map<int, int>::iterator lower = expected.lower_bound(key);
+            map<int, int>::iterator upper = expected.upper_bound(key);
+            PathAVLTree<int, int>::iterator gotLower = tree.lower_bound(key);
+            PathAVLTree<int, int>::iterator gotUpper = tree.upper_bound(key);
+            for (; lower != expected.end() && gotLower != tree.end(); ++lower, ++gotLower) {
+                if (gotLower->first != lower->first) break;
+            }
+            for (; upper != expected.end() && gotUpper != tree.end(); ++upper, ++gotUpper) {
+                if (gotUpper->first != upper->first) break;
+            }
+            check(lower == expected.end() && gotLower == tree.end(), "PathAVLTree::lower_bound");
+            check(upper == expected.end() && gotUpper == tree.end(), "PathAVLTree::upper_bound");
+        }
+    }
+    check(twoChildRemoves > 100, "PathAVLTree test removes nodes with two children");
+
+    for (map<int, int>::iterator it = expected.begin(); it != expected.end(); ++it) tree.remove(it->first);
+    check(tree.empty() && tree.begin() == tree.end() && tree.isBalanced(), "PathAVLTree removes every key");
+}
+
+string readFile(const string& path)
+{
+    ifstream in(path.c_str(), ios::binary);
+    ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+void writeFile(const string& path, const string& contents)
+{
+    ofstream out(path.c_str(), ios::binary | ios::trunc);
+    out << contents;
+}
+
+void removeDurableFiles(const string& base)
+{
+    std::remove((base + ".log").c_str());
+    std::remove((base + ".snapshot").c_str());
+}
+
+/**
+ * The recovery paths of DurableAVLTree: a torn record at the end of the
+ * log, a record whose checksum does not match, a crash between the
+ * checkpoint's rename and its log truncation, and a commit whose write
+ * fails halfway and is retried.
+ */
+void testDurableAVLTree()
+{
+    typedef DurableAVLTree<int, int> Durable;
+    const string base = "bst-test-durable";
+    const size_t INSERT_RECORD = 8 + 1 + 4 + 4;  // frame, operation, key, value
+
+    // torn tail: the fragment is cut off and later records follow valid data
+    removeDurableFiles(base);
+    map<int, int> expected;
+    {
+        Durable tree(base);
+        for (int key = 0; key < 10; ++key) {
+            tree.insert(std::make_pair(key, key));
+            expected[key] = key;
+        }
+        tree.commit();
+    }
+    string log = readFile(base + ".log");
+    check(log.size() == 10 * INSERT_RECORD, "DurableAVLTree log size");
+    writeFile(base + ".log", log + log.substr(0, INSERT_RECORD - 3));
+    {
+        Durable tree(base);
+        check(sameItems(tree.tree(), expected) && tree.logRecords() == 10, "DurableAVLTree drops a torn tail");
+        check(readFile(base + ".log") == log, "DurableAVLTree cuts the log back to the last good record");
+        tree.insert(std::make_pair(100, 100));
+        expected[100] = 100;
+    }
+    {
+        Durable tree(base);
+        check(sameItems(tree.tree(), expected), "DurableAVLTree appends after a cut torn tail");
+    }
+
+    // corrupt checksum: replay stops at the bad record and drops the rest
+    log = readFile(base + ".log");
+    log[3 * INSERT_RECORD + 8 + 2] ^= 0x40;
+    writeFile(base + ".log", log);
+    {
+        Durable tree(base);
+        map<int, int> prefix;
+        for (int key = 0; key < 3; ++key) prefix[key] = key;
+        check(sameItems(tree.tree(), prefix) && tree.logRecords() == 3, "DurableAVLTree stops at a bad checksum");
+        check(readFile(base + ".log").size() == 3 * INSERT_RECORD, "DurableAVLTree cuts a corrupt record");
+    }
+
+    // crash between the rename and the truncation: the log is replayed over
+    // a snapshot that already holds its effects
+    removeDurableFiles(base);
+    expected.clear();
+    {
+        Durable tree(base);
+        for (int key = 0; key < 20; ++key) {
+            tree.insert(std::make_pair(key, key));
+            expected[key] = key;
+        }
+        for (int key = 0; key < 20; key += 3) {
+            tree.remove(key);
+            expected.erase(key);
+        }
+        tree.insert(std::make_pair(3, 33));
+        expected[3] = 33;
+        tree.commit();
+        log = readFile(base + ".log");
+        tree.checkpoint();
+        check(readFile(base + ".log").empty(), "DurableAVLTree::checkpoint truncates the log");
+    }
+    writeFile(base + ".log", log);
+    {
+        Durable tree(base);
+        check(sameItems(tree.tree(), expected), "DurableAVLTree replays a log the snapshot covers");
+        check(tree.tree().isBalanced(), "DurableAVLTree balance after recovery");
+    }
+
+    // a write cut short by the file size limit fails the commit; the retry
+    // must not leave the fragment in front of its records
+    removeDurableFiles(base);
+    expected.clear();
+    struct rlimit saved;
+    getrlimit(RLIMIT_FSIZE, &saved);
+    void (*oldHandler)(int) = std::signal(SIGXFSZ, SIG_IGN);
+    {
+        Durable tree(base, 1000);
+        for (int key = 0; key < 4; ++key) {
+            tree.insert(std::make_pair(key, key));
+            expected[key] = key;
+        }
+        tree.commit();
+        for (int key = 4; key < 8; ++key) {
+            tree.insert(std::make_pair(key, key));
+            expected[key] = key;
+        }
+        struct rlimit limit = saved;
+        limit.rlim_cur = 6 * INSERT_RECORD + 5;
+        bool threw = false;
+        if (setrlimit(RLIMIT_FSIZE, &limit) == 0) {
+            try {
+                tree.commit();
+            } catch (const std::runtime_error&) {
+                threw = true;
+            }
+            setrlimit(RLIMIT_FSIZE, &saved);
+            check(threw, "DurableAVLTree::commit reports a short write");
+            check(readFile(base + ".log").size() == 4 * INSERT_RECORD,
+                  "DurableAVLTree::commit cuts a failed write back");
+        }
+        tree.commit();
+    }
+    std::signal(SIGXFSZ, oldHandler);
+    {
+        Durable tree(base);
+        check(sameItems(tree.tree(), expected) && tree.logRecords() == 8,
+              "DurableAVLTree keeps records committed after a failed write");
+    }
+    removeDurableFiles(base);
+}
+
+static_assert(std::is_same<FixedAVLIndex<63>::type, uint8_t>::value, "63 slots fit a uint8_t index");
+static_assert(std::is_same<FixedAVLIndex<64>::type, uint16_t>::value, "64 slots need a uint16_t index");
+
+/**
+ * Random inserts and removes on a FixedAVLMap of N items against std::map,
+ * never allocating, then a full map refusing a new key without changing.
+ */
+template<size_t N>
+void testFixedMap(const string& name)
+{
+    mt19937 rng(45);
+    FixedAVLMap<int, int, N> tree;
+    map<int, int> expected;
+    // only the tree's own calls are counted, std::map allocates
+    uint64_t allocated = 0;
+    bool balanced = true;
+    bool same = true;
+    for (int op = 0; op < 20000; ++op) {
+        int key = (int)(rng() % (2 * N));
+        bool insert = rng() % 2 == 0 && (expected.size() < N || expected.count(key) == 1);
+        uint64_t before = allocations.load();
+        if (insert) {
+            tree.insert(std::make_pair(key, op));
+        } else {
+            tree.remove(key);
+        }
+        bool found = tree.contains(key);
+        allocated += allocations.load() - before;
+        if (insert) {
+            expected[key] = op;
+        } else {
+            expected.erase(key);
+        }
+        same = same && found == insert;
+        if (op % 100 == 0) {
+            balanced = balanced && tree.isBalanced();
+            same = same && tree.size() == expected.size() && sameItems(tree, expected);
+        }
+    }
+    check(allocated == 0, name + " never allocates");
+    check(balanced, name + " balance");
+    check(same && sameItems(tree, expected), name + " items");
+
+    for (int key = 0; expected.size() < N; ++key) {
+        tree.insert(std::make_pair(key, key));
+        expected[key] = key;
+    }
+    bool threw = false;
+    try {
+        tree.insert(std::make_pair(-1, -1));
+    } catch (const std::length_error&) {
+        threw = true;
+    }
+    check(threw, name + " insert into a full map throws std::length_error");
+    check(tree.size() == N && sameItems(tree, expected) && tree.isBalanced(), name + " unchanged after a refused insert");
+    tree.insert(std::make_pair(expected.begin()->first, 7));
+    expected.begin()->second = 7;
+    check(sameItems(tree, expected), name + " full map still updates present keys");
+}
+
+void testFixedAVLMap()
+{
+    testFixedMap<63>("FixedAVLMap<63>");
+    testFixedMap<64>("FixedAVLMap<64>");
+}
+
+/**
+ * Random inserts and removes on a HybridMap against std::map, in phases
+ * that grow and shrink it across both thresholds again and again.  The
+ * mode must change exactly at the thresholds, and lookups, operator[] and
+ * iteration must agree in either mode.
+ */
+void testHybridMap()
+{
+    const size_t PROMOTE = 32;
+    const size_t DEMOTE = 12;
+    mt19937 rng(46);
+    HybridMap<int, int> hybrid(PROMOTE, DEMOTE);
+    map<int, int> expected;
+    bool flat = true;
+    size_t promotions = 0;
+    size_t demotions = 0;
+    for (int op = 0; op < 30000; ++op) {
+        bool growing = op / 300 % 2 == 0;
+        int key = (int)(rng() % 80);
+        if (rng() % 8 != 0 ? growing : !growing) {
+            bool isNew = expected.count(key) == 0;
+            if (flat && isNew && expected.size() == PROMOTE) {
+                flat = false;
+                ++promotions;
+            }
+            hybrid.insert(std::make_pair(key, op));
+            expected[key] = op;
+        } else {
+            if (expected.erase(key) == 1 && !flat && expected.size() < DEMOTE) {
+                flat = true;
+                ++demotions;
+            }
+            hybrid.remove(key);
+        }
+        check(hybrid.isFlat() == flat, "HybridMap switches mode at the thresholds");
+        check(hybrid.size() == expected.size(), "HybridMap::size");
+
+        int probe = (int)(rng() % 80);
+        map<int, int>::iterator want = expected.find(probe);
+        HybridMap<int, int>::iterator got = hybrid.find(probe);
+        if (want == expected.end()) {
+            check(got == hybrid.end() && !hybrid.contains(probe) && hybrid.count(probe) == 0,
+                  "HybridMap::find of a missing key");
+        } else {
+            check(got != hybrid.end() && got->first == probe && got->second == want->second &&
+                  hybrid[probe] == want->second, "HybridMap::find of a present key");
+        }
+        if (op % 50 == 0) check(sameItems(hybrid, expected), "HybridMap iteration");
+    }
+    check(promotions > 20 && demotions > 20, "HybridMap test crosses both thresholds repeatedly");
+
+    bool threw = false;
+    try {
+        HybridMap<int, int> invalid(8, 9);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "HybridMap rejects demoteBelow above promoteAbove");
+}
+
+/**
+ * Compares std::string keys against const char* probes in place, without
+ * building a std::string from the probe.
+ */
+struct TransparentLess
+{
+    typedef void is_transparent;
+
+    bool operator()(const string& lhs, const string& rhs) const { return lhs < rhs; }
+    bool operator()(const string& lhs, const char* rhs) const { return lhs.compare(rhs) < 0; }
+    bool operator()(const char* lhs, const string& rhs) const { return rhs.compare(lhs) > 0; }
+};
+
+/**
+ * Random lookups, bounds and removes by const char* against std::map.  The
+ * keys are too long for the small string buffer, so a temporary key would
+ * show up as an allocation.
+ */
+template<typename Tree>
+void testHeterogeneousTree(const string& name)
+{
+    mt19937 rng(28);
+    Tree tree;
+    map<string, int> expected;
+    for (int i = 0; i < 600; ++i) {
+        string key = "a-key-too-long-for-sso-" + to_string(rng() % 1000);
+        tree.insert(std::make_pair(key, i));
+        expected[key] = i;
+    }
+
+    for (int op = 0; op < 4000; ++op) {
+        string text = "a-key-too-long-for-sso-" + to_string(rng() % 1000);
+        const char* probe = text.c_str();
+        map<string, int>::iterator want = expected.find(text);
+        map<string, int>::iterator lower = expected.lower_bound(text);
+        map<string, int>::iterator upper = expected.upper_bound(text);
+
+        uint64_t before = allocations.load();
+        typename Tree::iterator found = tree.find(probe);
+        size_t count = tree.count(probe);
+        bool contains = tree.contains(probe);
+        typename Tree::iterator gotLower = tree.lower_bound(probe);
+        typename Tree::iterator gotUpper = tree.upper_bound(probe);
+        bool allocated = allocations.load() != before;
+        check(!allocated, name + " const char* lookups build no std::string");
+
+        bool present = want != expected.end();
+        check(present ? found != tree.end() && found->second == want->second : found == tree.end(),
+              name + "::find(const char*)");
+        check(count == (present ? 1u : 0u) && contains == present, name + "::count/contains(const char*)");
+        check(lower == expected.end() ? gotLower == tree.end()
+                                      : gotLower != tree.end() && gotLower->first == lower->first,
+              name + "::lower_bound(const char*)");
+        check(upper == expected.end() ? gotUpper == tree.end()
+                                      : gotUpper != tree.end() && gotUpper->first == upper->first,
+              name + "::upper_bound(const char*)");
+        if (op % 4 == 0) {
+            before = allocations.load();
+            tree.remove(probe);
+            allocated = allocations.load() != before;
+            check(!allocated, name + "::remove(const char*) builds no std::string");
+            if (present) expected.erase(want);
+        }
+    }
+    check(sameItems(tree, expected), name + "::remove(const char*)");
+    check(tree.isBalanced(), name + " balance after remove(const char*)");
+}
+
+void testHeterogeneousLookup()
+{
+    testHeterogeneousTree<AVLTree<string, int, TransparentLess> >("AVLTree");
+    testHeterogeneousTree<CompactAVLTree<string, int, TransparentLess> >("CompactAVLTree");
+}
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +1512,28 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
+    testLazyAVLTree();
+    testAVLMultiMap();
+    testParallelWalk();
+    testBulkBuild();
+    testRedBlackTree();
+    testSplayTree();
+    testTreeExport();
+    testCompactAVLTree();
+    testPathAVLTree();
+    testDurableAVLTree();
+    testFixedAVLMap();
+    testHybridMap();
+    testThreeWayCompare();
+    testHeterogeneousLookup();
+    testMerge();
+    testExtractInsert();
+    testCopyMove();
+
+    if (failures != 0) {
+        cout << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "\nAll checks passed" << endl;
     return 0;
 }
@@ -6,6 +6,10 @@
 #include <cstdlib>
 #include <utility>
 #include <stack>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "tree_metrics.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -21,6 +25,11 @@ public:
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
     virtual ~Node();
 
+    // Allocates a copy of this node, including any data a subclass keeps
+    // in it.  The copy's links still point into the original tree; the
+    // caller relinks them.  Every node subclass overrides it.
+    virtual Node<Key, Value>* clone() const;
+
     const std::pair<const Key, Value>& getItem() const;
     std::pair<const Key, Value>& getItem();
     const Key& getKey() const;
@@ -73,6 +82,12 @@ Node<Key, Value>::~Node()
 
 }
 
+template<typename Key, typename Value>
+Node<Key, Value>* Node<Key, Value>::clone() const
+{
+    return new Node<Key, Value>(*this);
+}
+
 /**
 * A const getter for the item.
 */
@@ -187,24 +202,85 @@ void Node<Key, Value>::setValue(const Value& value)
   ---------------------------------------
 */
 
+/**
+* A three-way comparator for keys with a compare() member (e.g. std::string).
+* It returns a negative, zero or positive int, so a search tree using it needs
+* only one key comparison per level.
+*/
+template <typename Key>
+struct ThreeWayCompare
+{
+    int operator()(const Key& lhs, const Key& rhs) const
+    {
+        return lhs.compare(rhs);
+    }
+};
+
+/**
+* Detects whether Compare is a three-way comparator (returns an int ordering)
+* rather than a strict weak ordering like std::less (returns a bool).
+*/
+template <typename Compare, typename Key>
+struct IsThreeWayCompare : std::integral_constant<bool,
+    !std::is_same<typename std::decay<decltype(std::declval<const Compare&>()(
+        std::declval<const Key&>(), std::declval<const Key&>()))>::type, bool>::value>
+{
+};
+
+/**
+* Detects whether Compare is transparent, i.e. declares is_transparent and can
+* compare keys against other types (a const char* against a std::string key)
+* without constructing a temporary Key.
+*/
+template <typename Compare, typename = void>
+struct IsTransparentCompare : std::false_type
+{
+};
+
+template <typename Compare>
+struct IsTransparentCompare<Compare, typename std::conditional<true, void,
+    typename Compare::is_transparent>::type> : std::true_type
+{
+};
+
+template <typename Key, typename Value, typename Compare>
+class TreeExporter;
+template <typename Key, typename Value, typename Compare>
+class ParallelWalk;
+
 /**
 * A templated unbalanced binary search tree.
+* Keys are ordered by Compare, which is either a strict weak ordering
+* (std::less by default) or a three-way comparator such as ThreeWayCompare.
 */
-template <typename Key, typename Value>
+template <typename Key, typename Value, typename Compare = std::less<Key> >
 class BinarySearchTree
 {
 public:
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
+    // Copies have the same shape as the original; moves take its nodes.
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other);
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other);
     virtual ~BinarySearchTree(); //TODO
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    void remove(const K& key);
+    // Virtual so that subclasses keeping counts next to the nodes reset
+    // them too when a base class function empties the tree.
+    virtual void clear(); //TODO
     bool isBalanced() const; //TODO
     void print() const;
     bool empty() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
+    friend class TreeExporter<Key, Value, Compare>;
+    friend class ParallelWalk<Key, Value, Compare>;
 public:
     /**
     * An internal iterator class for traversing the contents of the BST.
@@ -223,7 +299,7 @@ public:
         iterator& operator++();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
+        friend class BinarySearchTree<Key, Value, Compare>;
         iterator(Node<Key,Value>* ptr);
         Node<Key, Value> *current_;
     };
@@ -232,12 +308,34 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    bool contains(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
+    // Heterogeneous lookups, only available when Compare is transparent.
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator find(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    size_t count(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    bool contains(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator lower_bound(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator upper_bound(const K& key) const;
+
 protected:
     // Mandatory helper functions
-    Node<Key, Value>* internalFind(const Key& k) const; // TODO
+    template<typename K>
+    Node<Key, Value>* internalFind(const K& k) const; // TODO
     Node<Key, Value> *getSmallestNode() const;  // TODO
     static Node<Key, Value>* predecessor(Node<Key, Value>* current); // TODO
     // Note:  static means these functions don't have a "this" pointer
@@ -249,14 +347,53 @@ protected:
 
     // Add helper functions here
 
-    int height(Node<Key, Value>* node) const;
-    bool isBalancedHelper(Node<Key, Value>* node) const;
-
 
+    // Whether node holds an item this tree's own iterators skip, so that
+    // walks working on the nodes directly (parallel_walk.h) skip it too.
+    virtual bool hidden(const Node<Key, Value>* node) const;
+
+    // Lets subclasses return iterators to nodes they located themselves,
+    // and get back the node an iterator points at.
+    static iterator iteratorAt(Node<Key, Value>* node);
+    static Node<Key, Value>* nodeAt(const iterator& it);
+
+    // Unlinks and deletes a node found by one of the lookups.
+    virtual void removeNode(Node<Key, Value>* node);
+
+    // Replaces the (empty) tree with a node-by-node copy of the tree under
+    // source, used by the copy constructor and assignment.
+    void copyFrom(Node<Key, Value>* source);
+
+    // Walks down to key using one comparison per level. Returns the node
+    // holding key, or NULL with parent/isLeft set to where it would attach.
+    template<typename K>
+    Node<Key, Value>* findPosition(const K& key, Node<Key, Value>*& parent, bool& isLeft) const;
+    template<typename K>
+    Node<Key, Value>* findPosition(const K& key, Node<Key, Value>*& parent, bool& isLeft,
+                                   std::false_type threeWay) const;
+    template<typename K>
+    Node<Key, Value>* findPosition(const K& key, Node<Key, Value>*& parent, bool& isLeft,
+                                   std::true_type threeWay) const;
+
+    // First node whose key is not less than (lower) or greater than (upper) key.
+    template<typename K>
+    Node<Key, Value>* lowerBoundNode(const K& key) const;
+    template<typename K>
+    Node<Key, Value>* upperBoundNode(const K& key) const;
+
+    // Single comparisons of a probe against a node key, for either kind of Compare.
+    template<typename K>
+    bool probeLess(const K& key, const Key& nodeKey, std::false_type threeWay) const;
+    template<typename K>
+    bool probeLess(const K& key, const Key& nodeKey, std::true_type threeWay) const;
+    template<typename K>
+    bool probeGreater(const K& key, const Key& nodeKey, std::false_type threeWay) const;
+    template<typename K>
+    bool probeGreater(const K& key, const Key& nodeKey, std::true_type threeWay) const;
 
 protected:
     Node<Key, Value>* root_;
-    // You should not need other data members
+    Compare comp_;
 };
 
 /*
@@ -268,8 +405,8 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator(Node<Key,Value> *ptr)
 {
     // TODO
 
@@ -279,8 +416,8 @@ BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::iterator::iterator() 
 {
     // TODO
 
@@ -291,9 +428,9 @@ BinarySearchTree<Key, Value>::iterator::iterator()
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -301,9 +438,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+BinarySearchTree<Key, Value, Compare>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -312,10 +449,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
 
@@ -326,10 +463,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare>::iterator& rhs) const
 {
     // TODO
 
@@ -341,9 +478,9 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator&
+BinarySearchTree<Key, Value, Compare>::iterator::operator++()
 {
     // TODO
 
@@ -388,16 +525,81 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree() :
+    comp_()
 {
     // TODO
 
     root_ = nullptr;
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Constructs an empty tree ordered by the given comparator.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const Compare& comp) :
+    root_(nullptr),
+    comp_(comp)
+{
+
+}
+
+/**
+* Copy constructor: a deep copy with the same shape, see copyFrom.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(const BinarySearchTree& other) :
+    root_(nullptr),
+    comp_(other.comp_)
+{
+    copyFrom(other.root_);
+}
+
+/**
+* Move constructor: takes other's nodes in O(1) and leaves other empty.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>::BinarySearchTree(BinarySearchTree&& other) :
+    root_(other.root_),
+    comp_(std::move(other.comp_))
+{
+    other.root_ = nullptr;
+}
+
+/**
+* Builds the copy before freeing the old nodes, so if a copy throws the
+* tree keeps its old contents.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(const BinarySearchTree& other)
+{
+    if (this == &other) return *this;
+    BinarySearchTree copy(other);
+    std::swap(root_, copy.root_);
+    comp_ = other.comp_;
+    return *this;
+}
+
+/**
+* Frees this tree's nodes, then takes other's in O(1) and leaves other
+* empty.
+*/
+template<class Key, class Value, class Compare>
+BinarySearchTree<Key, Value, Compare>&
+BinarySearchTree<Key, Value, Compare>::operator=(BinarySearchTree&& other)
+{
+    if (this == &other) return *this;
+    clear();
+    root_ = other.root_;
+    comp_ = std::move(other.comp_);
+    other.root_ = nullptr;
+    return *this;
+}
+
+template<typename Key, typename Value, typename Compare>
+BinarySearchTree<Key, Value, Compare>::~BinarySearchTree()
 {
     // TODO
 
@@ -407,14 +609,14 @@ BinarySearchTree<Key, Value>::~BinarySearchTree()
 /**
  * Returns true if tree is empty
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::empty() const
 {
     return root_ == NULL;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::print() const
 {
     printRoot(root_);
     std::cout << "\n";
@@ -423,22 +625,22 @@ void BinarySearchTree<Key, Value>::print() const
 /**
 * Returns an iterator to the "smallest" item in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    BinarySearchTree<Key, Value, Compare>::iterator begin(getSmallestNode());
     return begin;
 }
 
 /**
 * Returns an iterator whose value means INVALID
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::end() const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL);
+    BinarySearchTree<Key, Value, Compare>::iterator end(NULL);
     return end;
 }
 
@@ -446,28 +648,123 @@ BinarySearchTree<Key, Value>::end() const
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const Key & k) const
 {
     Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
+    BinarySearchTree<Key, Value, Compare>::iterator it(curr);
     return it;
 }
 
+template<typename Key, typename Value, typename Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::iteratorAt(Node<Key, Value>* node)
+{
+    return iterator(node);
+}
+
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::nodeAt(const iterator& it)
+{
+    return it.current_;
+}
+
+/**
+* Returns the number of items with the given key (0 or 1).
+*/
+template<class Key, class Value, class Compare>
+size_t BinarySearchTree<Key, Value, Compare>::count(const Key & k) const
+{
+    return internalFind(k) == NULL ? 0 : 1;
+}
+
+/**
+* Returns true iff an item with the given key exists in the tree.
+*/
+template<class Key, class Value, class Compare>
+bool BinarySearchTree<Key, Value, Compare>::contains(const Key & k) const
+{
+    return internalFind(k) != NULL;
+}
+
+/**
+* Returns an iterator to the first item whose key is not less than k,
+* or the end iterator if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const Key & k) const
+{
+    return iterator(lowerBoundNode(k));
+}
+
+/**
+* Returns an iterator to the first item whose key is greater than k,
+* or the end iterator if there is none.
+*/
+template<class Key, class Value, class Compare>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const Key & k) const
+{
+    return iterator(upperBoundNode(k));
+}
+
+/**
+* Heterogeneous versions of the lookups above. They pass the probe straight
+* to the transparent comparator, so no temporary Key is constructed.
+*/
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::find(const K & k) const
+{
+    return iterator(internalFind(k));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+size_t BinarySearchTree<Key, Value, Compare>::count(const K & k) const
+{
+    return internalFind(k) == NULL ? 0 : 1;
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+bool BinarySearchTree<Key, Value, Compare>::contains(const K & k) const
+{
+    return internalFind(k) != NULL;
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::lower_bound(const K & k) const
+{
+    return iterator(lowerBoundNode(k));
+}
+
+template<class Key, class Value, class Compare>
+template<typename K, typename C, typename>
+typename BinarySearchTree<Key, Value, Compare>::iterator
+BinarySearchTree<Key, Value, Compare>::upper_bound(const K & k) const
+{
+    return iterator(upperBoundNode(k));
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
  */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare>
+Value& BinarySearchTree<Key, Value, Compare>::operator[](const Key& key)
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+template<class Key, class Value, class Compare>
+Value const & BinarySearchTree<Key, Value, Compare>::operator[](const Key& key) const
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
@@ -480,34 +777,24 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 * Recall: If key is already in the tree, you should 
 * overwrite the current value with the updated value.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare>
+void BinarySearchTree<Key, Value, Compare>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
     // TODO
 
-    if (root_ == nullptr){
-        root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
-        return;
-    }
-
-    Node<Key, Value>* current = root_;
-    Node<Key, Value>*  parent = nullptr;
-
+    Node<Key, Value>* parent = nullptr;
+    bool isLeft = false;
+    Node<Key, Value>* current = findPosition(keyValuePair.first, parent, isLeft);
 
-    while (current != nullptr){
-        parent = current;
-        if (keyValuePair.first < current->getKey()){
-            current = current->getLeft();
-        } else if (keyValuePair.first > current->getKey()){
-            current = current->getRight();
-        } else {
-            current->getValue() = keyValuePair.second;
-            return;
-        }
+    if (current != nullptr){
+        current->getValue() = keyValuePair.second;
+        return;
     }
 
     Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
-    if (keyValuePair.first < parent->getKey()) {
+    if (parent == nullptr){
+        root_ = newNode;
+    } else if (isLeft) {
         parent->setLeft(newNode);
     } else {
         parent->setRight(newNode);
@@ -521,10 +808,28 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 * Recall: The writeup specifies that if a node has 2 children you
 * should swap with the predecessor and then remove.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::remove(const Key& key)
+{
+    removeNode(internalFind(key));
+}
+
+/**
+* Heterogeneous remove, only available when Compare is transparent.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K, typename C, typename>
+void BinarySearchTree<Key, Value, Compare>::remove(const K& key)
+{
+    removeNode(internalFind(key));
+}
+
+/**
+* Unlinks node from the tree and frees it. Does nothing if node is NULL.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::removeNode(Node<Key, Value>* node)
 {
-    Node<Key, Value>* node = internalFind(key);
     if (node == nullptr) return;
 
     if (node->getLeft() != nullptr && node->getRight() != nullptr) {
@@ -559,9 +864,9 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 
 
 
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare>::predecessor(Node<Key, Value>* current)
 {
     if (current == nullptr) return nullptr;
 
@@ -586,8 +891,8 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::clear()
 {
     // TODO
 
@@ -624,12 +929,64 @@ void BinarySearchTree<Key, Value>::clear()
 }
 
 
+/**
+* Walks the source and the copy in step, using the parent links instead of
+* a stack: a copy's child is still NULL exactly when that side has not been
+* copied yet.  Nodes are cloned (keeping their balance, color or subtree
+* data) and attached where their originals are, so there are no key
+* comparisons and no rebalancing, and the walk takes O(n) time and O(1)
+* extra memory.  If a clone throws, the partial copy is freed.
+*/
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::copyFrom(Node<Key, Value>* source)
+{
+    if (source == NULL) return;
+    Node<Key, Value>* copy = source->clone();
+    copy->setParent(NULL);
+    copy->setLeft(NULL);
+    copy->setRight(NULL);
+    root_ = copy;
+
+    try {
+        while (source != NULL) {
+            Node<Key, Value>* child = NULL;
+            bool isLeft = false;
+            if (source->getLeft() != NULL && copy->getLeft() == NULL) {
+                child = source->getLeft();
+                isLeft = true;
+            } else if (source->getRight() != NULL && copy->getRight() == NULL) {
+                child = source->getRight();
+            }
+            if (child == NULL) {
+                source = source->getParent();
+                copy = copy->getParent();
+                continue;
+            }
+
+            Node<Key, Value>* childCopy = child->clone();
+            childCopy->setParent(copy);
+            childCopy->setLeft(NULL);
+            childCopy->setRight(NULL);
+            if (isLeft) {
+                copy->setLeft(childCopy);
+            } else {
+                copy->setRight(childCopy);
+            }
+            source = child;
+            copy = childCopy;
+        }
+    } catch (...) {
+        clear();
+        throw;
+    }
+}
+
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::getSmallestNode() const
+BinarySearchTree<Key, Value, Compare>::getSmallestNode() const
 {
     // TODO
 
@@ -648,58 +1005,165 @@ BinarySearchTree<Key, Value>::getSmallestNode() const
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::internalFind(const K& key) const
 {
     // TODO
 
+    Node<Key, Value>* parent;
+    bool isLeft;
+    return findPosition(key, parent, isLeft);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findPosition(
+    const K& key, Node<Key, Value>*& parent, bool& isLeft) const
+{
+    return findPosition(key, parent, isLeft, IsThreeWayCompare<Compare, Key>());
+}
+
+/**
+* Two-way descent: remember the last node whose key is not less than key
+* (going left there), and test that single candidate for equality once at
+* the bottom instead of testing == at every level.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findPosition(
+    const K& key, Node<Key, Value>*& parent, bool& isLeft, std::false_type) const
+{
     Node<Key, Value>* current = root_;
+    Node<Key, Value>* candidate = nullptr;
+    parent = nullptr;
+    isLeft = false;
 
     while (current != nullptr){
-        if (key == current->getKey()){
-            return current;
-        } else if (key < current->getKey()){
+        parent = current;
+        if (!comp_(current->getKey(), key)){
+            candidate = current;
+            isLeft = true;
             current = current->getLeft();
         } else {
+            isLeft = false;
             current = current->getRight();
         }
     }
 
+    if (candidate != nullptr && !comp_(key, candidate->getKey())){
+        return candidate;
+    }
     return nullptr;
 }
 
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::height(Node<Key, Value>* node) const
+/**
+* Three-way descent: a single comparison per level decides found/left/right.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::findPosition(
+    const K& key, Node<Key, Value>*& parent, bool& isLeft, std::true_type) const
 {
-    if (node == NULL) return -1;
-    return 1 + std::max(height(node->getLeft()), height(node->getRight()));
+    Node<Key, Value>* current = root_;
+    parent = nullptr;
+    isLeft = false;
+
+    while (current != nullptr){
+        int order = comp_(key, current->getKey());
+        if (order == 0){
+            return current;
+        }
+        parent = current;
+        isLeft = order < 0;
+        current = isLeft ? current->getLeft() : current->getRight();
+    }
+
+    return nullptr;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::lowerBoundNode(const K& key) const
+{
+    Node<Key, Value>* current = root_;
+    Node<Key, Value>* candidate = nullptr;
+
+    while (current != nullptr){
+        if (!probeGreater(key, current->getKey(), IsThreeWayCompare<Compare, Key>())){
+            candidate = current;
+            current = current->getLeft();
+        } else {
+            current = current->getRight();
+        }
+    }
+    return candidate;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare>::upperBoundNode(const K& key) const
+{
+    Node<Key, Value>* current = root_;
+    Node<Key, Value>* candidate = nullptr;
+
+    while (current != nullptr){
+        if (probeLess(key, current->getKey(), IsThreeWayCompare<Compare, Key>())){
+            candidate = current;
+            current = current->getLeft();
+        } else {
+            current = current->getRight();
+        }
+    }
+    return candidate;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+bool BinarySearchTree<Key, Value, Compare>::probeLess(const K& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(key, nodeKey);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+bool BinarySearchTree<Key, Value, Compare>::probeLess(const K& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) < 0;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+bool BinarySearchTree<Key, Value, Compare>::probeGreater(const K& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(nodeKey, key);
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename K>
+bool BinarySearchTree<Key, Value, Compare>::probeGreater(const K& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) > 0;
 }
 
 /**
- * Return true iff the BST is balanced.
+ * Return true iff the BST is balanced.  One iterative pass that stops at
+ * the first unbalanced node.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::isBalanced() const
 {
-    return isBalancedHelper(root_);
+    return measureTree<GetterChildren<Node<Key, Value> > >(root_, METRIC_BALANCE, true).balanced;
 }
 
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key, Value>* node) const
+template<typename Key, typename Value, typename Compare>
+bool BinarySearchTree<Key, Value, Compare>::hidden(const Node<Key, Value>* /*node*/) const
 {
-    if (node == NULL) return true;
-    
-    int leftHeight = height(node->getLeft());
-    int rightHeight = height(node->getRight());
-    
-    if (std::abs(leftHeight - rightHeight) > 1) return false;
-    
-    return isBalancedHelper(node->getLeft()) && isBalancedHelper(node->getRight());
+    return false;
 }
 
-
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
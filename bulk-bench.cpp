@@ -0,0 +1,75 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Indexes n unsorted pairs (with some repeated keys) by inserting them one
+ * at a time, then with the bulk constructor for an increasing number of
+ * threads.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 2000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (argc > 2) {
+        maxThreads = (size_t)strtoull(argv[2], NULL, 10);
+    }
+    if (maxThreads < 8) maxThreads = 8;
+
+    std::mt19937_64 rng(109);
+    vector<pair<uint64_t, uint64_t> > items(n);
+    for (size_t i = 0; i < n; ++i) {
+        items[i] = make_pair(rng() % (4 * n / 5), (uint64_t)i);
+    }
+
+    cout << "n = " << n << ", hardware threads = " << std::thread::hardware_concurrency() << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+
+    uint64_t expected = 0;
+    {
+        counters.start();
+        AVLTree<uint64_t, uint64_t> tree;
+        for (size_t i = 0; i < n; ++i) {
+            tree.insert(std::make_pair(items[i].first, items[i].second));
+        }
+        printPerOperation(cout, "insert one by one", counters.stop(), n, counters.available());
+        for (AVLTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+            expected += it->first * 31 + it->second;
+        }
+    }
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<pair<uint64_t, uint64_t> > copy(items);
+        counters.start();
+        AVLTree<uint64_t, uint64_t> tree(std::move(copy), threads);
+        printPerOperation(cout, "bulk build, " + to_string(threads) + " threads",
+                          counters.stop(), n, counters.available());
+
+        uint64_t check = 0;
+        for (AVLTree<uint64_t, uint64_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+            check += it->first * 31 + it->second;
+        }
+        if (check != expected || !tree.isBalanced()) {
+            cout << "mismatch with " << threads << " threads" << endl;
+            return 1;
+        }
+    }
+    sink = expected;
+    return 0;
+}
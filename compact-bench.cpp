@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "compactavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Times insert, find, a full iteration and remove on one tree type and
+ * prints per-operation wall time and cache misses.
+ */
+template<typename Tree>
+void benchTree(const string& name, const vector<uint32_t>& keys, const vector<uint32_t>& lookups)
+{
+    PerfCounters counters;
+    Tree tree;
+
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    printPerOperation(cout, name + "::insert", counters.stop(), keys.size(), counters.available());
+
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) ++found;
+    }
+    printPerOperation(cout, name + "::find", counters.stop(), lookups.size(), counters.available());
+
+    uint64_t sum = 0;
+    counters.start();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    printPerOperation(cout, name + "::iterator::operator++", counters.stop(), keys.size(), counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        tree.remove(lookups[i]);
+    }
+    printPerOperation(cout, name + "::remove", counters.stop(), lookups.size(), counters.available());
+    sink = found + sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint32_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)i;
+    }
+    std::mt19937 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    vector<uint32_t> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    // AVLNode allocations also pay the allocator's per-block header.
+    cout << "bytes per node: AVLNode<uint32_t,uint32_t> = " << sizeof(AVLNode<uint32_t, uint32_t>)
+         << " (+ malloc header), CompactAVLTree<uint32_t,uint32_t> slot = "
+         << sizeof(CompactAVLTree<uint32_t, uint32_t>::Slot) << endl;
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    benchTree<AVLTree<uint32_t, uint32_t> >("AVLTree", keys, lookups);
+    benchTree<CompactAVLTree<uint32_t, uint32_t> >("CompactAVLTree", keys, lookups);
+
+    return 0;
+}
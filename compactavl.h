@@ -0,0 +1,1110 @@
+#ifndef COMPACTAVL_H
+#define COMPACTAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <limits>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A compact AVL tree whose nodes live in one contiguous array and refer to
+* each other by small integer indices instead of pointers.
+*
+* Each slot holds the item, the left and right child indices, and the parent
+* index with the balance packed into its two low bits.  There is no vtable.
+* For CompactAVLTree<uint32_t, uint32_t> a slot is 20 bytes, compared to
+* 48 bytes (plus allocator overhead) for an AVLNode.
+*
+* Index 0 means "no node", so slot i lives at slots()[i - 1].  Removed slots
+* go on a free list (linked through their left index) and are reused by the
+* next insert, which keeps the array dense.
+*
+* Where the slots live is decided by the StoragePolicy (see HeapSlots below),
+* so the same tree code can run on a growable heap array or on other backing
+* memory.  Iterators and pointers to items are invalidated when the storage
+* grows.
+*/
+
+/**
+* The per-tree bookkeeping kept next to the slots.
+*/
+template <typename Index>
+struct CompactHeader
+{
+    Index root;
+    Index freeList;
+    Index used;     // high water mark of slots ever handed out
+    Index count;    // number of live items
+};
+
+/**
+* One node of a CompactAVLTree.  The item is constructed in place only while
+* the slot is in use, so freed slots do not keep a Key or Value alive.
+*/
+template <typename Key, typename Value, typename Index>
+struct CompactSlot
+{
+    typedef Index index_type;
+    typedef std::pair<const Key, Value> item_type;
+
+    // balance code stored in the low bits of parentBalance: balance + 1,
+    // or FREE_CODE for slots on the free list
+    static const Index BALANCE_MASK = 3;
+    static const Index FREE_CODE = 3;
+
+    union
+    {
+        // the union only provides correctly aligned raw storage for the item
+        unsigned char raw[sizeof(item_type)];
+        typename std::aligned_storage<sizeof(item_type), alignof(item_type)>::type align;
+    } storage;
+    Index left;
+    Index right;
+    Index parentBalance;
+
+    item_type& item()
+    {
+        return *reinterpret_cast<item_type*>(storage.raw);
+    }
+
+    const item_type& item() const
+    {
+        return *reinterpret_cast<const item_type*>(storage.raw);
+    }
+
+    bool live() const
+    {
+        return (parentBalance & BALANCE_MASK) != FREE_CODE;
+    }
+
+    // Moves src into the uninitialized slot dst, leaving src uninitialized.
+    static void relocate(CompactSlot* dst, CompactSlot* src)
+    {
+        dst->left = src->left;
+        dst->right = src->right;
+        dst->parentBalance = src->parentBalance;
+        if (src->live()) {
+            new (dst->storage.raw) item_type(std::move(src->item()));
+            src->item().~item_type();
+        }
+    }
+};
+
+/**
+* Storage policy that keeps the slots in a heap array which doubles when full.
+*/
+struct HeapSlots
+{
+    template <typename Slot>
+    class storage
+    {
+    public:
+        typedef typename Slot::index_type index_type;
+
+        storage() : slots_(NULL), capacity_(0)
+        {
+            header_.root = 0;
+            header_.freeList = 0;
+            header_.used = 0;
+            header_.count = 0;
+        }
+
+        ~storage()
+        {
+            ::operator delete(slots_);
+        }
+
+        CompactHeader<index_type>& header() { return header_; }
+        const CompactHeader<index_type>& header() const { return header_; }
+        Slot* slots() const { return slots_; }
+        size_t capacity() const { return capacity_; }
+
+        // Makes room for at least n slots, relocating the live ones.
+        void reserve(size_t n)
+        {
+            if (n <= capacity_) return;
+            size_t newCapacity = std::max(n, capacity_ * 2);
+            Slot* newSlots = static_cast<Slot*>(::operator new(newCapacity * sizeof(Slot)));
+            for (size_t i = 0; i < header_.used; ++i) {
+                Slot::relocate(&newSlots[i], &slots_[i]);
+            }
+            ::operator delete(slots_);
+            slots_ = newSlots;
+            capacity_ = newCapacity;
+        }
+
+        // Gives the memory back once the tree has destroyed every item.
+        void release()
+        {
+            ::operator delete(slots_);
+            slots_ = NULL;
+            capacity_ = 0;
+        }
+
+    private:
+        storage(const storage&);
+        storage& operator=(const storage&);
+
+        CompactHeader<index_type> header_;
+        Slot* slots_;
+        size_t capacity_;
+    };
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>,
+          typename Index = uint32_t, typename StoragePolicy = HeapSlots>
+class CompactAVLTree
+{
+public:
+    typedef CompactSlot<Key, Value, Index> Slot;
+    typedef typename StoragePolicy::template storage<Slot> Storage;
+    typedef typename Slot::item_type item_type;
+
+    CompactAVLTree();
+    explicit CompactAVLTree(const Compare& comp);
+    ~CompactAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    void remove(const K& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+    size_t size() const;
+    void reserve(size_t n);
+
+    // Largest number of items an Index can address (two bits hold the balance).
+    static size_t maxSize();
+
+    /**
+    * An iterator over the items in key order.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>;
+        iterator(const CompactAVLTree* tree, Index current);
+        const CompactAVLTree* tree_;
+        Index current_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    bool contains(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    // Heterogeneous lookups, only available when Compare is transparent.
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator find(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    size_t count(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    bool contains(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator lower_bound(const K& key) const;
+    template<typename K, typename C = Compare,
+             typename = typename std::enable_if<IsTransparentCompare<C>::value>::type>
+    iterator upper_bound(const K& key) const;
+
+protected:
+    // Lets subclasses construct the storage themselves (e.g. to open a file).
+    template<typename Arg>
+    CompactAVLTree(const Compare& comp, Arg& storageArg);
+
+    // Slot accessors; index 0 is the null index.
+    Slot& slot(Index i) const;
+    Index left(Index i) const;
+    Index right(Index i) const;
+    Index parent(Index i) const;
+    int balance(Index i) const;
+    void setLeft(Index i, Index child);
+    void setRight(Index i, Index child);
+    void setParent(Index i, Index parent);
+    void setBalance(Index i, int balance);
+    const Key& keyOf(Index i) const;
+
+    Index allocateSlot(const std::pair<const Key, Value>& keyValuePair, Index parent);
+    void freeSlot(Index i);
+    void replaceChild(Index parent, Index oldChild, Index newChild);
+
+    template<typename K>
+    Index internalFind(const K& key) const;
+    template<typename K>
+    Index findPosition(const K& key, Index& parent, bool& isLeft) const;
+    template<typename K>
+    Index findPosition(const K& key, Index& parent, bool& isLeft, std::false_type threeWay) const;
+    template<typename K>
+    Index findPosition(const K& key, Index& parent, bool& isLeft, std::true_type threeWay) const;
+    template<typename K>
+    Index lowerBoundIndex(const K& key) const;
+    template<typename K>
+    Index upperBoundIndex(const K& key) const;
+    template<typename K>
+    bool probeLess(const K& key, const Key& nodeKey, std::false_type threeWay) const;
+    template<typename K>
+    bool probeLess(const K& key, const Key& nodeKey, std::true_type threeWay) const;
+    template<typename K>
+    bool probeGreater(const K& key, const Key& nodeKey, std::false_type threeWay) const;
+    template<typename K>
+    bool probeGreater(const K& key, const Key& nodeKey, std::true_type threeWay) const;
+
+    void removeIndex(Index node);
+    void rotateLeft(Index node);
+    void rotateRight(Index node);
+    void insertRetrace(Index node);
+    void removeRetrace(Index parent, bool fromLeft);
+    Index smallest() const;
+    Index successor(Index i) const;
+    int checkedHeight(Index i) const;
+    void destroyItems();
+
+    Storage storage_;
+    Compare comp_;
+
+private:
+    CompactAVLTree(const CompactAVLTree&);
+    CompactAVLTree& operator=(const CompactAVLTree&);
+};
+
+/*
+--------------------------------------------------------------
+Begin implementations for the CompactAVLTree::iterator class.
+--------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::iterator() :
+    tree_(NULL),
+    current_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::iterator(const CompactAVLTree* tree, Index current) :
+    tree_(tree),
+    current_(current)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+std::pair<const Key,Value>&
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::operator*() const
+{
+    return tree_->slot(current_).item();
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+std::pair<const Key,Value>*
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::operator->() const
+{
+    return &(tree_->slot(current_).item());
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances to the in-order successor, following parent indices upwards.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator&
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator::operator++()
+{
+    if (current_ != 0) {
+        current_ = tree_->successor(current_);
+    }
+    return *this;
+}
+
+/*
+------------------------------------------------------------
+End implementations for the CompactAVLTree::iterator class.
+------------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::CompactAVLTree() :
+    storage_(),
+    comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::CompactAVLTree(const Compare& comp) :
+    storage_(),
+    comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename Arg>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::CompactAVLTree(const Compare& comp, Arg& storageArg) :
+    storage_(storageArg),
+    comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::~CompactAVLTree()
+{
+    // the storage frees its own memory; the header is left alone so that
+    // persistent storage keeps the tree
+    destroyItems();
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::empty() const
+{
+    return storage_.header().root == 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+size_t CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::size() const
+{
+    return storage_.header().count;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+size_t CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::maxSize()
+{
+    return (size_t)(std::numeric_limits<Index>::max() >> 2);
+}
+
+/**
+* Preallocates room for n items so that inserts up to n do not relocate.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::reserve(size_t n)
+{
+    if (n > maxSize()) throw std::length_error("CompactAVLTree: too many items for the index type");
+    storage_.reserve(n);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::Slot&
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::slot(Index i) const
+{
+    return storage_.slots()[i - 1];
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::left(Index i) const
+{
+    return slot(i).left;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::right(Index i) const
+{
+    return slot(i).right;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::parent(Index i) const
+{
+    return (Index)(slot(i).parentBalance >> 2);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+int CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::balance(Index i) const
+{
+    return (int)(slot(i).parentBalance & Slot::BALANCE_MASK) - 1;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::setLeft(Index i, Index child)
+{
+    slot(i).left = child;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::setRight(Index i, Index child)
+{
+    slot(i).right = child;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::setParent(Index i, Index parentIndex)
+{
+    Slot& s = slot(i);
+    s.parentBalance = (Index)((parentIndex << 2) | (s.parentBalance & Slot::BALANCE_MASK));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::setBalance(Index i, int bal)
+{
+    Slot& s = slot(i);
+    s.parentBalance = (Index)((s.parentBalance & ~Slot::BALANCE_MASK) | (Index)(bal + 1));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+const Key& CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::keyOf(Index i) const
+{
+    return slot(i).item().first;
+}
+
+/**
+* Takes a slot from the free list (or the end of the array, growing it if
+* needed) and constructs the item in it with balance 0.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::allocateSlot(
+    const std::pair<const Key, Value>& keyValuePair, Index parentIndex)
+{
+    Index i = storage_.header().freeList;
+    if (i != 0) {
+        storage_.header().freeList = slot(i).left;
+    } else {
+        if ((size_t)storage_.header().used >= maxSize()) {
+            throw std::length_error("CompactAVLTree: too many items for the index type");
+        }
+        // the header may live inside the storage, so it is looked up again
+        // after reserve
+        storage_.reserve((size_t)storage_.header().used + 1);
+        i = (Index)(storage_.header().used + 1);
+        storage_.header().used = i;
+    }
+
+    Slot& s = slot(i);
+    new (s.storage.raw) typename Slot::item_type(keyValuePair.first, keyValuePair.second);
+    s.left = 0;
+    s.right = 0;
+    s.parentBalance = (Index)((parentIndex << 2) | 1);
+    ++storage_.header().count;
+    return i;
+}
+
+/**
+* Destroys the item in slot i and pushes the slot on the free list.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::freeSlot(Index i)
+{
+    CompactHeader<Index>& header = storage_.header();
+    Slot& s = slot(i);
+    s.item().~item_type();
+    s.parentBalance = Slot::FREE_CODE;
+    s.right = 0;
+    s.left = header.freeList;
+    header.freeList = i;
+    --header.count;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::replaceChild(Index parentIndex, Index oldChild, Index newChild)
+{
+    if (parentIndex == 0) {
+        storage_.header().root = newChild;
+    } else if (left(parentIndex) == oldChild) {
+        setLeft(parentIndex, newChild);
+    } else {
+        setRight(parentIndex, newChild);
+    }
+}
+
+/**
+* Single comparisons of a probe against a node key, for either kind of
+* Compare (see IsThreeWayCompare in bst.h).
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::probeLess(const K& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(key, nodeKey);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::probeLess(const K& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) < 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::probeGreater(const K& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(nodeKey, key);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::probeGreater(const K& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) > 0;
+}
+
+/**
+* Walks down to key with one comparison per level, like
+* BinarySearchTree::findPosition. Returns the index holding key, or 0 with
+* parent/isLeft set to where a new slot would attach.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::findPosition(const K& key, Index& parentIndex, bool& isLeft) const
+{
+    return findPosition(key, parentIndex, isLeft, IsThreeWayCompare<Compare, Key>());
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::findPosition(
+    const K& key, Index& parentIndex, bool& isLeft, std::false_type threeWay) const
+{
+    Index current = storage_.header().root;
+    Index candidate = 0;
+    parentIndex = 0;
+    isLeft = false;
+
+    while (current != 0) {
+        parentIndex = current;
+        if (!probeGreater(key, keyOf(current), threeWay)) {
+            candidate = current;
+            isLeft = true;
+            current = left(current);
+        } else {
+            isLeft = false;
+            current = right(current);
+        }
+    }
+    if (candidate != 0 && !probeLess(key, keyOf(candidate), threeWay)) {
+        return candidate;
+    }
+    return 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::findPosition(
+    const K& key, Index& parentIndex, bool& isLeft, std::true_type) const
+{
+    Index current = storage_.header().root;
+    parentIndex = 0;
+    isLeft = false;
+
+    while (current != 0) {
+        int order = comp_(key, keyOf(current));
+        if (order == 0) return current;
+        parentIndex = current;
+        isLeft = order < 0;
+        current = isLeft ? left(current) : right(current);
+    }
+    return 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::internalFind(const K& key) const
+{
+    Index parentIndex;
+    bool isLeft;
+    return findPosition(key, parentIndex, isLeft);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::lowerBoundIndex(const K& key) const
+{
+    Index current = storage_.header().root;
+    Index candidate = 0;
+    while (current != 0) {
+        if (!probeGreater(key, keyOf(current), IsThreeWayCompare<Compare, Key>())) {
+            candidate = current;
+            current = left(current);
+        } else {
+            current = right(current);
+        }
+    }
+    return candidate;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::upperBoundIndex(const K& key) const
+{
+    Index current = storage_.header().root;
+    Index candidate = 0;
+    while (current != 0) {
+        if (probeLess(key, keyOf(current), IsThreeWayCompare<Compare, Key>())) {
+            candidate = current;
+            current = left(current);
+        } else {
+            current = right(current);
+        }
+    }
+    return candidate;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::smallest() const
+{
+    Index current = storage_.header().root;
+    if (current == 0) return 0;
+    while (left(current) != 0) {
+        current = left(current);
+    }
+    return current;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Index CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::successor(Index current) const
+{
+    if (right(current) != 0) {
+        current = right(current);
+        while (left(current) != 0) {
+            current = left(current);
+        }
+        return current;
+    }
+
+    Index p = parent(current);
+    while (p != 0 && current == right(p)) {
+        current = p;
+        p = parent(p);
+    }
+    return p;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::begin() const
+{
+    return iterator(this, smallest());
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::end() const
+{
+    return iterator(this, 0);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::find(const Key& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+size_t CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::count(const Key& key) const
+{
+    return internalFind(key) == 0 ? 0 : 1;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::contains(const Key& key) const
+{
+    return internalFind(key) != 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::lower_bound(const Key& key) const
+{
+    return iterator(this, lowerBoundIndex(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::upper_bound(const Key& key) const
+{
+    return iterator(this, upperBoundIndex(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::find(const K& key) const
+{
+    return iterator(this, internalFind(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+size_t CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::count(const K& key) const
+{
+    return internalFind(key) == 0 ? 0 : 1;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::contains(const K& key) const
+{
+    return internalFind(key) != 0;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::lower_bound(const K& key) const
+{
+    return iterator(this, lowerBoundIndex(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+typename CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::iterator
+CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::upper_bound(const K& key) const
+{
+    return iterator(this, upperBoundIndex(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Value& CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::operator[](const Key& key)
+{
+    Index i = internalFind(key);
+    if (i == 0) throw std::out_of_range("Invalid key");
+    return slot(i).item().second;
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+Value const & CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::operator[](const Key& key) const
+{
+    Index i = internalFind(key);
+    if (i == 0) throw std::out_of_range("Invalid key");
+    return slot(i).item().second;
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten.
+ */
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    Index parentIndex;
+    bool isLeft;
+    Index existing = findPosition(keyValuePair.first, parentIndex, isLeft);
+    if (existing != 0) {
+        slot(existing).item().second = keyValuePair.second;
+        return;
+    }
+
+    // allocateSlot may relocate the array, but indices stay valid
+    Index node = allocateSlot(keyValuePair, parentIndex);
+    if (parentIndex == 0) {
+        storage_.header().root = node;
+        return;
+    }
+    if (isLeft) {
+        setLeft(parentIndex, node);
+    } else {
+        setRight(parentIndex, node);
+    }
+    insertRetrace(node);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::remove(const Key& key)
+{
+    removeIndex(internalFind(key));
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+template<typename K, typename C, typename>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::remove(const K& key)
+{
+    removeIndex(internalFind(key));
+}
+
+/**
+* Removes the slot at index node.  A node with two children is replaced in
+* the tree by its predecessor, as AVLTree does with nodeSwap, by relinking
+* indices; items are never moved.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::removeIndex(Index node)
+{
+    if (node == 0) return;
+
+    Index retraceFrom;
+    bool fromLeft;
+
+    if (left(node) != 0 && right(node) != 0) {
+        Index pred = left(node);
+        while (right(pred) != 0) {
+            pred = right(pred);
+        }
+
+        if (parent(pred) == node) {
+            // pred keeps its left subtree, which is one level shorter than node's was
+            retraceFrom = pred;
+            fromLeft = true;
+        } else {
+            Index predParent = parent(pred);
+            Index predChild = left(pred);
+            setRight(predParent, predChild);
+            if (predChild != 0) setParent(predChild, predParent);
+            setLeft(pred, left(node));
+            setParent(left(node), pred);
+            retraceFrom = predParent;
+            fromLeft = false;
+        }
+
+        setRight(pred, right(node));
+        setParent(right(node), pred);
+        Index nodeParent = parent(node);
+        replaceChild(nodeParent, node, pred);
+        setParent(pred, nodeParent);
+        setBalance(pred, balance(node));
+    } else {
+        Index child = left(node) != 0 ? left(node) : right(node);
+        Index nodeParent = parent(node);
+        fromLeft = nodeParent != 0 && left(nodeParent) == node;
+        replaceChild(nodeParent, node, child);
+        if (child != 0) setParent(child, nodeParent);
+        retraceFrom = nodeParent;
+    }
+
+    freeSlot(node);
+    removeRetrace(retraceFrom, fromLeft);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::rotateLeft(Index node)
+{
+    Index r = right(node);
+    Index p = parent(node);
+    Index inner = left(r);
+
+    setRight(node, inner);
+    if (inner != 0) setParent(inner, node);
+    setLeft(r, node);
+    setParent(node, r);
+    setParent(r, p);
+    replaceChild(p, node, r);
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::rotateRight(Index node)
+{
+    Index l = left(node);
+    Index p = parent(node);
+    Index inner = right(l);
+
+    setLeft(node, inner);
+    if (inner != 0) setParent(inner, node);
+    setRight(l, node);
+    setParent(node, l);
+    setParent(l, p);
+    replaceChild(p, node, l);
+}
+
+/**
+* Walks up from a freshly linked leaf, updating balances until a subtree's
+* height stops growing, and does at most one single or double rotation.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::insertRetrace(Index node)
+{
+    Index child = node;
+    for (Index p = parent(child); p != 0; child = p, p = parent(p)) {
+        int bal = balance(p) + (child == left(p) ? -1 : 1);
+        if (bal == 0) {
+            setBalance(p, 0);
+            return;
+        }
+        if (bal == -1 || bal == 1) {
+            setBalance(p, bal);
+            continue;
+        }
+
+        if (bal == -2) {
+            if (balance(child) == -1) {
+                rotateRight(p);
+                setBalance(p, 0);
+                setBalance(child, 0);
+            } else {
+                Index g = right(child);
+                int gbal = balance(g);
+                rotateLeft(child);
+                rotateRight(p);
+                setBalance(p, gbal == -1 ? 1 : 0);
+                setBalance(child, gbal == 1 ? -1 : 0);
+                setBalance(g, 0);
+            }
+        } else {
+            if (balance(child) == 1) {
+                rotateLeft(p);
+                setBalance(p, 0);
+                setBalance(child, 0);
+            } else {
+                Index g = left(child);
+                int gbal = balance(g);
+                rotateRight(child);
+                rotateLeft(p);
+                setBalance(p, gbal == 1 ? -1 : 0);
+                setBalance(child, gbal == -1 ? 1 : 0);
+                setBalance(g, 0);
+            }
+        }
+        return;
+    }
+}
+
+/**
+* Walks up after a subtree of p (the left one iff fromLeft) got one level
+* shorter, rotating where needed, until some subtree's height is unchanged.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::removeRetrace(Index p, bool fromLeft)
+{
+    while (p != 0) {
+        int bal = balance(p) + (fromLeft ? 1 : -1);
+        Index next = parent(p);
+        bool nextFromLeft = next != 0 && left(next) == p;
+
+        if (bal == -1 || bal == 1) {
+            setBalance(p, bal);
+            return;
+        }
+        if (bal == 2) {
+            Index r = right(p);
+            int rbal = balance(r);
+            if (rbal >= 0) {
+                rotateLeft(p);
+                if (rbal == 0) {
+                    setBalance(p, 1);
+                    setBalance(r, -1);
+                    return;
+                }
+                setBalance(p, 0);
+                setBalance(r, 0);
+            } else {
+                Index rl = left(r);
+                int rlbal = balance(rl);
+                rotateRight(r);
+                rotateLeft(p);
+                setBalance(p, rlbal == 1 ? -1 : 0);
+                setBalance(r, rlbal == -1 ? 1 : 0);
+                setBalance(rl, 0);
+            }
+        } else if (bal == -2) {
+            Index l = left(p);
+            int lbal = balance(l);
+            if (lbal <= 0) {
+                rotateRight(p);
+                if (lbal == 0) {
+                    setBalance(p, -1);
+                    setBalance(l, 1);
+                    return;
+                }
+                setBalance(p, 0);
+                setBalance(l, 0);
+            } else {
+                Index lr = right(l);
+                int lrbal = balance(lr);
+                rotateLeft(l);
+                rotateRight(p);
+                setBalance(p, lrbal == -1 ? 1 : 0);
+                setBalance(l, lrbal == 1 ? -1 : 0);
+                setBalance(lr, 0);
+            }
+        } else {
+            setBalance(p, 0);
+        }
+
+        p = next;
+        fromLeft = nextFromLeft;
+    }
+}
+
+/**
+* Destroys every live item.  The slot array is linear, so no traversal is
+* needed, and trivially destructible items need no pass at all.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::destroyItems()
+{
+    if (std::is_trivially_destructible<item_type>::value) return;
+
+    size_t used = (size_t)storage_.header().used;
+    for (size_t i = 1; i <= used; ++i) {
+        Slot& s = slot((Index)i);
+        if (s.live()) {
+            s.item().~item_type();
+        }
+    }
+}
+
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+void CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::clear()
+{
+    destroyItems();
+    CompactHeader<Index>& header = storage_.header();
+    header.root = 0;
+    header.freeList = 0;
+    header.used = 0;
+    header.count = 0;
+    storage_.release();
+}
+
+/**
+* Returns the height of the subtree at i, or -1 if it is not AVL balanced.
+*/
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+int CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::checkedHeight(Index i) const
+{
+    if (i == 0) return 0;
+    int lh = checkedHeight(left(i));
+    int rh = checkedHeight(right(i));
+    if (lh < 0 || rh < 0 || std::abs(lh - rh) > 1) return -1;
+    return 1 + std::max(lh, rh);
+}
+
+/**
+ * Return true iff the tree is balanced.
+ */
+template<class Key, class Value, class Compare, class Index, class StoragePolicy>
+bool CompactAVLTree<Key, Value, Compare, Index, StoragePolicy>::isBalanced() const
+{
+    return checkedHeight(storage_.header().root) >= 0;
+}
+
+#endif
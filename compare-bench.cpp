@@ -0,0 +1,201 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include <new>
+#include <cstring>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+#include "alloc_counter.h"
+
+using namespace std;
+
+// Total number of key comparisons made by the counting comparators below.
+static uint64_t comparisons = 0;
+
+struct CountingLess
+{
+    bool operator()(const string& lhs, const string& rhs) const
+    {
+        ++comparisons;
+        return lhs < rhs;
+    }
+};
+
+struct CountingThreeWay
+{
+    int operator()(const string& lhs, const string& rhs) const
+    {
+        ++comparisons;
+        return lhs.compare(rhs);
+    }
+};
+
+/**
+ * A transparent comparator: const char* probes are compared against the
+ * std::string keys in place instead of being converted first.
+ */
+struct TransparentLess
+{
+    typedef void is_transparent;
+
+    bool operator()(const string& lhs, const string& rhs) const
+    {
+        ++comparisons;
+        return lhs < rhs;
+    }
+    bool operator()(const string& lhs, const char* rhs) const
+    {
+        ++comparisons;
+        return lhs.compare(rhs) < 0;
+    }
+    bool operator()(const char* lhs, const string& rhs) const
+    {
+        ++comparisons;
+        return rhs.compare(lhs) > 0;
+    }
+};
+
+/**
+ * Exposes the search the trees used before the Compare policy: test ==
+ * and then < at every level.  Used as the baseline for the comparison count.
+ */
+class LegacyProbeTree : public AVLTree<string, int>
+{
+public:
+    bool legacyFind(const string& key) const
+    {
+        Node<string, int>* current = this->root_;
+        while (current != NULL) {
+            ++comparisons;
+            if (key == current->getKey()) {
+                return true;
+            }
+            ++comparisons;
+            if (key < current->getKey()) {
+                current = current->getLeft();
+            } else {
+                current = current->getRight();
+            }
+        }
+        return false;
+    }
+};
+
+volatile size_t sink;
+
+void report(const string& label, uint64_t compares, const PerfCounters::Sample& sample, size_t ops)
+{
+    cout << left << setw(44) << label << right << fixed << setprecision(2)
+         << setw(16) << (double)compares / ops
+         << setw(12) << (double)sample.nanoseconds / ops << endl;
+}
+
+template<typename Tree>
+void benchTree(const string& name, const vector<string>& keys, const vector<string>& probes)
+{
+    PerfCounters counters;
+    Tree tree;
+
+    comparisons = 0;
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+    report(name + "::insert", comparisons, counters.stop(), keys.size());
+
+    size_t found = 0;
+    comparisons = 0;
+    counters.start();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        if (tree.find(probes[i]) != tree.end()) ++found;
+    }
+    report(name + "::find", comparisons, counters.stop(), probes.size());
+    sink = found;
+}
+
+/**
+ * Looks keys up from raw const char* buffers, as they arrive off the wire.
+ */
+template<typename Tree>
+void benchCStringFind(const string& name, const vector<string>& keys, const vector<string>& probes)
+{
+    PerfCounters counters;
+    Tree tree;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], (int)i));
+    }
+
+    size_t found = 0;
+    comparisons = 0;
+    uint64_t startAllocations = allocations;
+    counters.start();
+    for (size_t i = 0; i < probes.size(); ++i) {
+        if (tree.find(probes[i].c_str()) != tree.end()) ++found;
+    }
+    PerfCounters::Sample sample = counters.stop();
+    report(name + "::find(const char*)", comparisons, sample, probes.size());
+    cout << left << setw(44) << "    allocations/op" << right << fixed << setprecision(2)
+         << setw(16) << (double)(allocations - startAllocations) / probes.size() << endl;
+    sink = found;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 100000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    // Keys share a long prefix so every string comparison does real work.
+    vector<string> keys(n);
+    char buffer[64];
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buffer, sizeof(buffer), "customer/region-eu/account-%012zu", i * 2);
+        keys[i] = buffer;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    // Half of the probes hit and half miss.
+    vector<string> probes;
+    for (size_t i = 0; i < n; ++i) {
+        snprintf(buffer, sizeof(buffer), "customer/region-eu/account-%012zu", i);
+        probes.push_back(buffer);
+    }
+    std::shuffle(probes.begin(), probes.end(), rng);
+
+    cout << "n = " << n << " std::string keys" << endl;
+    cout << left << setw(44) << "operation" << right << setw(16) << "compares/op" << setw(12) << "ns/op" << endl;
+
+    {
+        PerfCounters counters;
+        LegacyProbeTree legacy;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            legacy.insert(std::make_pair(keys[i], (int)i));
+        }
+        size_t found = 0;
+        comparisons = 0;
+        counters.start();
+        for (size_t i = 0; i < probes.size(); ++i) {
+            if (legacy.legacyFind(probes[i])) ++found;
+        }
+        report("legacy ==/< find", comparisons, counters.stop(), probes.size());
+        sink = found;
+    }
+
+    benchTree<AVLTree<string, int, CountingLess> >("AVLTree<less>", keys, probes);
+    benchTree<AVLTree<string, int, CountingThreeWay> >("AVLTree<three-way>", keys, probes);
+    benchTree<BinarySearchTree<string, int, CountingLess> >("BinarySearchTree<less>", keys, probes);
+    benchTree<BinarySearchTree<string, int, CountingThreeWay> >("BinarySearchTree<three-way>", keys, probes);
+
+    benchCStringFind<AVLTree<string, int, CountingLess> >("AVLTree<less>", keys, probes);
+    benchCStringFind<AVLTree<string, int, TransparentLess> >("AVLTree<transparent>", keys, probes);
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Compares duplicating an AVLTree with the copy constructor against
+ * re-inserting every item, and times a move.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint32_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)i;
+    }
+    std::mt19937 rng(48);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    AVLTree<uint32_t, uint32_t> tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+
+    counters.start();
+    AVLTree<uint32_t, uint32_t> reinserted;
+    for (AVLTree<uint32_t, uint32_t>::iterator it = tree.begin(); it != tree.end(); ++it) {
+        reinserted.insert(*it);
+    }
+    printPerOperation(cout, "re-insert in key order (per item)", counters.stop(), n, counters.available());
+
+    counters.start();
+    AVLTree<uint32_t, uint32_t> copy(tree);
+    printPerOperation(cout, "copy constructor (per item)", counters.stop(), n, counters.available());
+
+    counters.start();
+    AVLTree<uint32_t, uint32_t> moved(std::move(copy));
+    printPerOperation(cout, "move constructor (whole tree)", counters.stop(), 1, counters.available());
+
+    uint64_t sum = 0;
+    for (AVLTree<uint32_t, uint32_t>::iterator it = moved.begin(); it != moved.end(); ++it) {
+        sum += it->second;
+    }
+    sink = sum + (reinserted.empty() ? 0 : 1) + (copy.empty() ? 0 : 1);
+    return 0;
+}
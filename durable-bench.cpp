@@ -0,0 +1,102 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "durableavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+static void removeFiles(const string& base)
+{
+    std::remove((base + ".log").c_str());
+    std::remove((base + ".snapshot").c_str());
+}
+
+/**
+ * Ingests keys with logging off (plain AVLTree) and on at several group
+ * commit sizes, then times a checkpoint and recovery from snapshot + log.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 200000;
+    string base = "./durable-bench";
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        base = string(argv[2]) + "/durable-bench";
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    PerfCounters counters;
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            tree.insert(std::make_pair(keys[i], keys[i]));
+        }
+        printPerOperation(cout, "AVLTree::insert (no log)", counters.stop(), n, counters.available());
+    }
+
+    // an fsync per record is slow, so that case only runs a prefix
+    size_t batches[] = { 1, 16, 256, 4096 };
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b) {
+        removeFiles(base);
+        size_t ops = batches[b] == 1 ? std::min(n, (size_t)2000) : n;
+        DurableAVLTree<uint64_t, uint64_t> durable(base, batches[b]);
+        counters.start();
+        for (size_t i = 0; i < ops; ++i) {
+            durable.insert(std::make_pair(keys[i], keys[i]));
+        }
+        durable.commit();
+        printPerOperation(cout, "DurableAVLTree::insert batch=" + std::to_string(batches[b]),
+                          counters.stop(), ops, counters.available());
+    }
+
+    // the log from the last run holds all n records
+    {
+        counters.start();
+        DurableAVLTree<uint64_t, uint64_t> durable(base);
+        printPerOperation(cout, "recover: replay n log records", counters.stop(), n, counters.available());
+
+        counters.start();
+        durable.checkpoint();
+        printPerOperation(cout, "checkpoint", counters.stop(), n, counters.available());
+
+        // leave a 10% tail in the log
+        for (size_t i = 0; i < n / 10; ++i) {
+            durable.remove(keys[i]);
+        }
+    }
+
+    counters.start();
+    DurableAVLTree<uint64_t, uint64_t> recovered(base);
+    printPerOperation(cout, "recover: snapshot + n/10 log tail", counters.stop(), n, counters.available());
+
+    bool ok = recovered.tree().isBalanced() && recovered.logRecords() == n / 10;
+    for (size_t i = 0; i < n && ok; ++i) {
+        ok = (recovered.tree().find(keys[i]) != recovered.tree().end()) == (i >= n / 10);
+    }
+    removeFiles(base);
+    if (!ok) {
+        cout << "recovered tree does not match" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,326 @@
+#ifndef DURABLEAVL_H
+#define DURABLEAVL_H
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "avlbst.h"
+#include "serializer.h"
+
+/**
+* An AVLTree made durable with an append-only operation log and periodic
+* snapshot checkpoints.
+*
+* Files live next to each other: basePath + ".snapshot" holds the last
+* checkpoint (written by AVLTree::save) and basePath + ".log" the updates
+* made since.  A log record is
+*
+*     uint32 length, uint32 checksum, payload
+*
+* where the payload is an operation byte followed by the key (and value for
+* inserts), encoded with Serializer.  The checksum is FNV-1a over the payload.
+*
+* insert and remove apply to the in-memory tree at once and buffer their
+* record.  Records become durable in group commits: one write and one fsync
+* for every batchSize records, or when commit() is called.  Every
+* checkpointEvery records (0 disables this) the tree is checkpointed: the
+* snapshot is written to a temporary file, fsynced, renamed over the old one,
+* and the log is truncated.
+*
+* Opening recovers the state: load the snapshot, then replay the log up to
+* the first torn or corrupt record, which is cut off.  Replay is idempotent,
+* so a crash between the rename and the log truncation is harmless.
+*
+* Records are written at the tracked end of the log rather than at the file
+* offset, and a failed commit cuts the log back to that end before it
+* throws.  So a retried commit never leaves a torn fragment in front of
+* later records, which recovery would cut off together with them.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class DurableAVLTree
+{
+public:
+    explicit DurableAVLTree(const std::string& basePath, size_t batchSize = 256, size_t checkpointEvery = 0);
+    ~DurableAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+
+    // Writes and fsyncs every buffered record.
+    void commit();
+    // Snapshots the tree and starts an empty log.
+    void checkpoint();
+
+    // Read access to the recovered tree.
+    const AVLTree<Key, Value, Compare>& tree() const;
+    // Number of records in the log since the last checkpoint, committed or not.
+    size_t logRecords() const;
+
+protected:
+    enum Operation { INSERT = 1, REMOVE = 2 };
+
+    void recover();
+    void appendRecord();
+    void failCommit(const std::string& what);
+    static uint32_t checksum(const char* data, size_t length);
+    static void fsyncPath(const std::string& path);
+    void fail(const std::string& what) const;
+
+    AVLTree<Key, Value, Compare> tree_;
+    std::string snapshotPath_;
+    std::string logPath_;
+    int logFd_;
+    off_t logEnd_;                // end of the last durable record
+    size_t batchSize_;
+    size_t checkpointEvery_;
+    size_t pendingRecords_;
+    size_t logRecords_;
+    std::string batch_;           // records waiting for the next group commit
+    std::ostringstream payload_;  // scratch buffer for one record's payload
+
+private:
+    DurableAVLTree(const DurableAVLTree&);
+    DurableAVLTree& operator=(const DurableAVLTree&);
+};
+
+template<class Key, class Value, class Compare>
+DurableAVLTree<Key, Value, Compare>::DurableAVLTree(const std::string& basePath, size_t batchSize,
+                                                    size_t checkpointEvery) :
+    snapshotPath_(basePath + ".snapshot"),
+    logPath_(basePath + ".log"),
+    logFd_(-1),
+    logEnd_(0),
+    batchSize_(batchSize == 0 ? 1 : batchSize),
+    checkpointEvery_(checkpointEvery),
+    pendingRecords_(0),
+    logRecords_(0)
+{
+    logFd_ = ::open(logPath_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (logFd_ < 0) fail("cannot open " + logPath_);
+    try {
+        recover();
+    } catch (...) {
+        ::close(logFd_);
+        throw;
+    }
+}
+
+/**
+* Commits what is still buffered.  Errors cannot be reported from here, so
+* call commit() first when they matter.
+*/
+template<class Key, class Value, class Compare>
+DurableAVLTree<Key, Value, Compare>::~DurableAVLTree()
+{
+    try {
+        commit();
+    } catch (...) {
+    }
+    ::close(logFd_);
+}
+
+template<class Key, class Value, class Compare>
+const AVLTree<Key, Value, Compare>& DurableAVLTree<Key, Value, Compare>::tree() const
+{
+    return tree_;
+}
+
+template<class Key, class Value, class Compare>
+size_t DurableAVLTree<Key, Value, Compare>::logRecords() const
+{
+    return logRecords_;
+}
+
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    payload_.str(std::string());
+    Serializer<uint8_t>::write(payload_, (uint8_t)INSERT);
+    Serializer<Key>::write(payload_, keyValuePair.first);
+    Serializer<Value>::write(payload_, keyValuePair.second);
+    tree_.insert(keyValuePair);
+    appendRecord();
+}
+
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    payload_.str(std::string());
+    Serializer<uint8_t>::write(payload_, (uint8_t)REMOVE);
+    Serializer<Key>::write(payload_, key);
+    tree_.remove(key);
+    appendRecord();
+}
+
+/**
+* Frames the payload just built and adds it to the batch, committing or
+* checkpointing when a threshold is reached.
+*/
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::appendRecord()
+{
+    const std::string& payload = payload_.str();
+    uint32_t frame[2] = { (uint32_t)payload.size(), checksum(payload.data(), payload.size()) };
+    batch_.append(reinterpret_cast<const char*>(frame), sizeof(frame));
+    batch_.append(payload);
+    ++pendingRecords_;
+    ++logRecords_;
+
+    if (checkpointEvery_ != 0 && logRecords_ >= checkpointEvery_) {
+        checkpoint();
+    } else if (pendingRecords_ >= batchSize_) {
+        commit();
+    }
+}
+
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::commit()
+{
+    if (pendingRecords_ == 0) return;
+
+    size_t written = 0;
+    while (written < batch_.size()) {
+        ssize_t n = ::pwrite(logFd_, batch_.data() + written, batch_.size() - written,
+                             logEnd_ + (off_t)written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) failCommit("write failed for " + logPath_);
+        written += (size_t)n;
+    }
+    if (::fdatasync(logFd_) != 0) failCommit("fsync failed for " + logPath_);
+    logEnd_ += (off_t)batch_.size();
+    batch_.clear();
+    pendingRecords_ = 0;
+}
+
+/**
+* Drops whatever part of the batch reached the file, keeping the batch so
+* that commit can be retried.  If even the truncation fails, the next
+* commit still writes over the fragment, starting at logEnd_.
+*/
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::failCommit(const std::string& what)
+{
+    int error = errno;
+    if (::ftruncate(logFd_, logEnd_) == 0) {
+        ::fdatasync(logFd_);
+    }
+    errno = error;
+    fail(what);
+}
+
+/**
+* The new snapshot replaces the old one atomically by rename, so a crash at
+* any point leaves either the old snapshot with the full log or the new one.
+*/
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::checkpoint()
+{
+    std::string tempPath = snapshotPath_ + ".tmp";
+    tree_.save(tempPath);
+    fsyncPath(tempPath);
+    if (::rename(tempPath.c_str(), snapshotPath_.c_str()) != 0) {
+        fail("cannot rename " + tempPath);
+    }
+    // make the rename itself durable
+    std::string::size_type slash = snapshotPath_.rfind('/');
+    fsyncPath(slash == std::string::npos ? std::string(".") : snapshotPath_.substr(0, slash + 1));
+
+    // the buffered records are covered by the snapshot
+    batch_.clear();
+    pendingRecords_ = 0;
+    logRecords_ = 0;
+    if (::ftruncate(logFd_, 0) != 0) fail("cannot truncate " + logPath_);
+    logEnd_ = 0;
+    if (::fdatasync(logFd_) != 0) fail("fsync failed for " + logPath_);
+}
+
+/**
+* Loads the snapshot if there is one, then replays the log.  The log is cut
+* back to the end of the last good record so new records follow valid data.
+*/
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::recover()
+{
+    struct stat st;
+    if (::stat(snapshotPath_.c_str(), &st) == 0) {
+        tree_.load(snapshotPath_);
+    }
+
+    std::string log;
+    {
+        std::ifstream in(logPath_.c_str(), std::ios::binary);
+        if (!in) fail("cannot read " + logPath_);
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        log = contents.str();
+    }
+
+    const size_t FRAME = 2 * sizeof(uint32_t);
+    size_t offset = 0;
+    while (log.size() - offset >= FRAME) {
+        uint32_t frame[2];
+        std::memcpy(frame, log.data() + offset, FRAME);
+        if (frame[0] == 0 || frame[0] > log.size() - offset - FRAME) break;
+        const char* payload = log.data() + offset + FRAME;
+        if (checksum(payload, frame[0]) != frame[1]) break;
+
+        std::istringstream record(std::string(payload, frame[0]));
+        try {
+            uint8_t operation = Serializer<uint8_t>::read(record);
+            Key key = Serializer<Key>::read(record);
+            if (operation == INSERT) {
+                Value value = Serializer<Value>::read(record);
+                tree_.insert(std::make_pair(key, value));
+            } else if (operation == REMOVE) {
+                tree_.remove(key);
+            } else {
+                break;
+            }
+        } catch (std::runtime_error&) {
+            break;
+        }
+        offset += FRAME + frame[0];
+        ++logRecords_;
+    }
+
+    if (offset != log.size() && ::ftruncate(logFd_, (off_t)offset) != 0) {
+        fail("cannot truncate " + logPath_);
+    }
+    logEnd_ = (off_t)offset;
+}
+
+template<class Key, class Value, class Compare>
+uint32_t DurableAVLTree<Key, Value, Compare>::checksum(const char* data, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::fsyncPath(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("DurableAVLTree: cannot open " + path);
+    int result = ::fsync(fd);
+    ::close(fd);
+    if (result != 0) throw std::runtime_error("DurableAVLTree: fsync failed for " + path);
+}
+
+template<class Key, class Value, class Compare>
+void DurableAVLTree<Key, Value, Compare>::fail(const std::string& what) const
+{
+    throw std::runtime_error("DurableAVLTree: " + what + ": " + std::strerror(errno));
+}
+
+#endif
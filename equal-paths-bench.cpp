@@ -0,0 +1,120 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+// The recursive implementation equalPaths used to have, for comparison.
+static pair<int, int> recursiveLeafDepths(Node* node)
+{
+    if (node->left == nullptr && node->right == nullptr) return make_pair(0, 0);
+    if (node->right == nullptr) {
+        pair<int, int> left = recursiveLeafDepths(node->left);
+        return make_pair(left.first + 1, left.second + 1);
+    }
+    if (node->left == nullptr) {
+        pair<int, int> right = recursiveLeafDepths(node->right);
+        return make_pair(right.first + 1, right.second + 1);
+    }
+    pair<int, int> left = recursiveLeafDepths(node->left);
+    pair<int, int> right = recursiveLeafDepths(node->right);
+    return make_pair(min(left.first, right.first) + 1, max(left.second, right.second) + 1);
+}
+
+static bool recursiveEqualPaths(Node* root)
+{
+    if (root == nullptr) return true;
+    pair<int, int> depths = recursiveLeafDepths(root);
+    return depths.first == depths.second;
+}
+
+// A perfect tree of the given height in nodes[first, ...), laid out in pre-order.
+static Node* buildPerfect(vector<Node>& nodes, size_t& next, int height)
+{
+    if (height == 0) return nullptr;
+    Node* node = &nodes[next++];
+    node->left = buildPerfect(nodes, next, height - 1);
+    node->right = buildPerfect(nodes, next, height - 1);
+    return node;
+}
+
+template<typename Check>
+void bench(const string& name, Check check, Node* root, bool expected, size_t nodes, PerfCounters& counters)
+{
+    counters.start();
+    bool result = check(root);
+    printPerOperation(cout, name, counters.stop(), nodes, counters.available());
+    if (result != expected) {
+        cout << name << " returned " << result << ", expected " << expected << endl;
+        exit(1);
+    }
+}
+
+/**
+ * Times the recursive, iterative and parallel checks on a perfect tree, the
+ * same tree with one short path at the left edge (an early mismatch),
+ * and a chain far deeper than the call stack allows recursing through.
+ */
+int main(int argc, char *argv[])
+{
+    int height = 22;
+    if (argc > 1) {
+        height = atoi(argv[1]);
+    }
+    size_t threads = std::thread::hardware_concurrency();
+    if (argc > 2) {
+        threads = (size_t)strtoull(argv[2], NULL, 10);
+    }
+    if (threads < 2) threads = 4;
+
+    size_t count = ((size_t)1 << height) - 1;
+    vector<Node> nodes(count, Node(0));
+    for (size_t i = 0; i < count; ++i) {
+        nodes[i].key = (int)i;
+    }
+    size_t next = 0;
+    Node* root = buildPerfect(nodes, next, height);
+
+    cout << "perfect tree of height " << height << " (" << count << " nodes), "
+         << threads << " threads for the parallel check" << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+    string parallel = "equalPathsParallel(" + to_string(threads) + ")";
+    auto parallelCheck = [threads](Node* r) { return equalPathsParallel(r, threads); };
+
+    bench("recursive, equal", recursiveEqualPaths, root, true, count, counters);
+    bench("equalPaths, equal", equalPaths, root, true, count, counters);
+    bench(parallel + ", equal", parallelCheck, root, true, count, counters);
+
+    // cut the two leaves under the leftmost bottom node, making it a leaf
+    // one level short
+    Node* parent = root;
+    while (parent->left->left != nullptr) parent = parent->left;
+    Node* removedLeft = parent->left;
+    Node* removedRight = parent->right;
+    parent->left = nullptr;
+    parent->right = nullptr;
+    bench("recursive, early mismatch", recursiveEqualPaths, root, false, count, counters);
+    bench("equalPaths, early mismatch", equalPaths, root, false, count, counters);
+    bench(parallel + ", early mismatch", parallelCheck, root, false, count, counters);
+    parent->left = removedLeft;
+    parent->right = removedRight;
+
+    // a chain this long overflows a default 8 MB stack when recursing
+    size_t chainLength = 10000000;
+    vector<Node> chain(chainLength, Node(0));
+    for (size_t i = 0; i + 1 < chainLength; ++i) {
+        chain[i].left = &chain[i + 1];
+    }
+    bench("equalPaths, 1e7 chain", equalPaths, &chain[0], true, chainLength, counters);
+    bench(parallel + ", 1e7 chain", parallelCheck, &chain[0], true, chainLength, counters);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include "equal-paths-parallel.h"
+#include "work_stealing_pool.h"
+using namespace std;
+
+namespace {
+
+// State shared by the workers checking one tree.
+struct LeafCheck
+{
+    std::atomic<int> leafDepth;   // -1 until some worker reaches a leaf
+    std::atomic<bool> mismatch;
+
+    LeafCheck() : leafDepth(-1), mismatch(false) {}
+
+    // Records a leaf at depth; returns false on a mismatch.
+    bool leaf(int depth)
+    {
+        int expected = -1;
+        if (leafDepth.compare_exchange_strong(expected, depth)) return true;
+        return expected == depth;
+    }
+
+    bool tooDeep(int depth) const
+    {
+        int known = leafDepth.load(std::memory_order_relaxed);
+        return known != -1 && depth >= known;
+    }
+};
+
+// The iterative walk of equalPaths, for a subtree whose root is at depth.
+void checkSubtree(Node* node, int depth, LeafCheck& check)
+{
+    std::vector<std::pair<Node*, int> > pending;
+    size_t steps = 0;
+
+    for (;;)
+    {
+        // other workers may have failed already; look every so often
+        if ((++steps & 1023) == 0 && check.mismatch.load(std::memory_order_relaxed)) return;
+
+        if (node->left == nullptr && node->right == nullptr)
+        {
+            if (!check.leaf(depth))
+            {
+                check.mismatch = true;
+                return;
+            }
+            if (pending.empty()) return;
+            node = pending.back().first;
+            depth = pending.back().second;
+            pending.pop_back();
+            continue;
+        }
+        if (check.tooDeep(depth))
+        {
+            check.mismatch = true;
+            return;
+        }
+
+        ++depth;
+        if (node->left == nullptr)
+        {
+            node = node->right;
+            continue;
+        }
+        if (node->right != nullptr) pending.push_back(std::make_pair(node->right, depth));
+        node = node->left;
+    }
+}
+
+// Collects the subtrees rooted at depth cut, plus the leaves above it, with
+// their depths.
+void splitTree(Node* node, int depth, int cut, std::vector<std::pair<Node*, int> >& pieces)
+{
+    std::vector<std::pair<Node*, int> > pending;
+    pending.push_back(std::make_pair(node, depth));
+    while (!pending.empty())
+    {
+        Node* current = pending.back().first;
+        int currentDepth = pending.back().second;
+        pending.pop_back();
+
+        if (currentDepth == cut || (current->left == nullptr && current->right == nullptr))
+        {
+            pieces.push_back(std::make_pair(current, currentDepth));
+            continue;
+        }
+        if (current->right != nullptr) pending.push_back(std::make_pair(current->right, currentDepth + 1));
+        if (current->left != nullptr) pending.push_back(std::make_pair(current->left, currentDepth + 1));
+    }
+}
+
+}
+
+bool equalPathsParallel(Node* root, size_t threads)
+{
+    if (root == nullptr) return true;
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads <= 1) return equalPaths(root);
+
+    LeafCheck check;
+    int cut = 0;
+    while (((size_t)1 << cut) < 8 * threads)
+    {
+        ++cut;
+    }
+    std::vector<std::pair<Node*, int> > pieces;
+    splitTree(root, 0, cut, pieces);
+
+    // workers run their newest task first, so submitting right to left
+    // starts each of them on its leftmost piece, in the serial order
+    WorkStealingPool pool(threads);
+    for (size_t i = pieces.size(); i-- > 0; )
+    {
+        const std::pair<Node*, int>& piece = pieces[i];
+        pool.submit([&piece, &check] {
+            if (!check.mismatch.load(std::memory_order_relaxed))
+            {
+                checkSubtree(piece.first, piece.second, check);
+            }
+        });
+    }
+    pool.wait();
+    return !check.mismatch;
+}
@@ -0,0 +1,21 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include <cstddef>
+#include "equal-paths.h"
+
+/**
+ * @brief Same result as equalPaths, computed with threads workers
+ *        (0: one per hardware thread).
+ *
+ *        The tree is cut a few levels below the root and the subtrees
+ *        there are checked in parallel.  All workers agree on the leaf
+ *        depth through a shared value and stop as soon as any of them
+ *        finds a mismatch.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param threads Number of worker threads
+ */
+bool equalPathsParallel(Node * root, size_t threads = 0);
+
+#endif
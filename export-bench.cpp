@@ -0,0 +1,63 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "tree_export.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+/**
+ * Streams a large tree as DOT and as JSON to a file (default /dev/null).
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    string path = argc > 2 ? argv[2] : "/dev/null";
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(110);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    AVLTree<uint64_t, uint64_t> tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    cout << "n = " << n << ", writing to " << path << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+    {
+        ofstream out(path.c_str());
+        counters.start();
+        exportDot(tree, out);
+        printPerOperation(cout, "exportDot", counters.stop(), n, counters.available());
+    }
+    {
+        ofstream out(path.c_str());
+        counters.start();
+        exportJson(tree, out);
+        printPerOperation(cout, "exportJson", counters.stop(), n, counters.available());
+    }
+    {
+        TreeExportOptions options;
+        options.sampleDepth = 4;
+        options.sampleEvery = 16;
+        ofstream out(path.c_str());
+        counters.start();
+        exportJson(tree, out, options);
+        printPerOperation(cout, "exportJson, 1/16 sampled (per tree node)", counters.stop(), n, counters.available());
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Moves every key in keys from one tree to another, once by remove and
+ * insert, which frees the node and allocates a new one with a copy of the
+ * item, and once by extract and insert, which relinks the same node.  The
+ * item is a string long enough to live on the heap, so the copy costs an
+ * allocation of its own.
+ */
+typedef AVLTree<uint32_t, string> Tree;
+
+void fill(Tree& tree, const vector<uint32_t>& keys)
+{
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], string("a value too long for the small-string buffer")));
+    }
+}
+
+void benchMove(size_t n)
+{
+    PerfCounters counters;
+    cout << "n = " << n << ", moving every item to a second tree of n items" << endl;
+    printPerOperationHeader(cout);
+
+    std::mt19937 rng(50);
+    vector<uint32_t> keys(n);
+    vector<uint32_t> otherKeys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)(2 * i);
+        otherKeys[i] = (uint32_t)(2 * i + 1);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    std::shuffle(otherKeys.begin(), otherKeys.end(), rng);
+
+    {
+        Tree from;
+        Tree to;
+        fill(from, keys);
+        fill(to, otherKeys);
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            Tree::iterator it = from.find(keys[i]);
+            to.insert(*it);
+            from.remove(keys[i]);
+        }
+        printPerOperation(cout, "find + insert + remove", counters.stop(), n, counters.available());
+        sink = to.empty() ? 0 : 1;
+    }
+    {
+        Tree from;
+        Tree to;
+        fill(from, keys);
+        fill(to, otherKeys);
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            to.insert(from.extract(keys[i]));
+        }
+        printPerOperation(cout, "extract + insert", counters.stop(), n, counters.available());
+        sink = to.empty() ? 0 : 1;
+    }
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    benchMove(n / 100);
+    benchMove(n);
+
+    return 0;
+}
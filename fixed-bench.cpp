@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "compactavl.h"
+#include "fixedavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+const size_t MAP_SIZE = 48;
+
+/**
+ * Builds, queries and drops many small maps, the way a short-lived
+ * per-request lookup table is used, and prints the time per map.
+ */
+template<typename Tree>
+void benchSmallMaps(const string& name, const vector<uint32_t>& keys, size_t maps)
+{
+    PerfCounters counters;
+    uint64_t found = 0;
+
+    counters.start();
+    for (size_t m = 0; m < maps; ++m) {
+        const uint32_t* batch = &keys[(m % (keys.size() / MAP_SIZE)) * MAP_SIZE];
+        Tree tree;
+        for (size_t i = 0; i < MAP_SIZE; ++i) {
+            tree.insert(std::make_pair(batch[i], batch[i]));
+        }
+        for (size_t i = 0; i < MAP_SIZE; ++i) {
+            if (tree.find(batch[i] ^ 1) != tree.end()) ++found;
+        }
+        for (size_t i = 0; i < MAP_SIZE; i += 2) {
+            tree.remove(batch[i]);
+        }
+    }
+    printPerOperation(cout, name + " per map", counters.stop(), maps, counters.available());
+    sink = found;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maps = 200000;
+    if (argc > 1) {
+        maps = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint32_t> keys(MAP_SIZE * 1024);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = (uint32_t)i;
+    }
+    std::mt19937 rng(45);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    cout << "sizeof FixedAVLMap<uint32_t,uint32_t," << MAP_SIZE << "> = "
+         << sizeof(FixedAVLMap<uint32_t, uint32_t, MAP_SIZE>) << " bytes, slot = "
+         << sizeof(FixedAVLMap<uint32_t, uint32_t, MAP_SIZE>::Slot) << " bytes" << endl;
+    cout << "maps = " << maps << "; each map: " << MAP_SIZE << " inserts, " << MAP_SIZE
+         << " finds, " << MAP_SIZE / 2 << " removes" << endl;
+    printPerOperationHeader(cout);
+    benchSmallMaps<AVLTree<uint32_t, uint32_t> >("AVLTree", keys, maps);
+    benchSmallMaps<CompactAVLTree<uint32_t, uint32_t> >("CompactAVLTree", keys, maps);
+    benchSmallMaps<FixedAVLMap<uint32_t, uint32_t, MAP_SIZE> >("FixedAVLMap", keys, maps);
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#ifndef FIXEDAVL_H
+#define FIXEDAVL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include "compactavl.h"
+
+/**
+* Storage policy for CompactAVLTree that keeps N slots inside the tree
+* object itself, so the tree never allocates.  Growing past N throws
+* std::length_error; the tree is left unchanged when that happens.
+*/
+template <size_t N>
+struct InlineSlots
+{
+    template <typename Slot>
+    class storage
+    {
+    public:
+        typedef typename Slot::index_type index_type;
+
+        storage()
+        {
+            header_.root = 0;
+            header_.freeList = 0;
+            header_.used = 0;
+            header_.count = 0;
+        }
+
+        CompactHeader<index_type>& header() { return header_; }
+        const CompactHeader<index_type>& header() const { return header_; }
+        Slot* slots() const { return reinterpret_cast<Slot*>(buffer_.raw); }
+        size_t capacity() const { return N; }
+
+        void reserve(size_t n)
+        {
+            if (n > N) throw std::length_error("FixedAVLMap: capacity exceeded");
+        }
+
+        void release()
+        {
+        }
+
+    private:
+        storage(const storage&);
+        storage& operator=(const storage&);
+
+        CompactHeader<index_type> header_;
+        // raw, correctly aligned room for the slots; items are constructed
+        // in place by the tree.  mutable because slots() is const, as for
+        // the pointer HeapSlots hands out.
+        mutable union
+        {
+            unsigned char raw[N * sizeof(Slot)];
+            typename std::aligned_storage<sizeof(Slot), alignof(Slot)>::type align;
+        } buffer_;
+    };
+};
+
+/**
+* The smallest index type that can address N slots: CompactAVLTree keeps
+* the balance in two bits of the parent index, so uint8_t covers up to 63
+* slots and uint16_t up to 16383.
+*/
+template <size_t N>
+struct FixedAVLIndex
+{
+    static_assert(N > 0 && N <= 16383, "FixedAVLMap holds between 1 and 16383 items");
+    typedef typename std::conditional<(N <= 63), uint8_t, uint16_t>::type type;
+};
+
+/**
+* An AVL map of at most N items with no dynamic allocation: the nodes live
+* in an array inside the object, linked by 8-bit (N <= 63) or 16-bit
+* indices, so the map can sit on the stack or inside another object.  It is
+* a CompactAVLTree, with the same insert/find/remove/iterator interface;
+* inserting a new key into a full map throws std::length_error.
+*
+* Like CompactAVLTree it cannot be copied.
+*/
+template <typename Key, typename Value, size_t N, typename Compare = std::less<Key> >
+using FixedAVLMap = CompactAVLTree<Key, Value, Compare, typename FixedAVLIndex<N>::type, InlineSlots<N> >;
+
+#endif
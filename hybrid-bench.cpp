@@ -0,0 +1,94 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "hybridmap.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Fills one map of n keys, then times lookups and a full iteration, each
+ * repeated until about ops operations have run.
+ */
+template<typename Map>
+void benchMap(const string& name, size_t n, size_t ops)
+{
+    vector<uint32_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)(2 * i);
+    }
+    std::mt19937 rng(46);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    PerfCounters counters;
+    Map map;
+    for (size_t i = 0; i < n; ++i) {
+        map.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    // half of the lookups miss
+    vector<uint32_t> lookups(4096);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookups[i] = (uint32_t)(rng() % (2 * n));
+    }
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < ops; ++i) {
+        if (map.find(lookups[i % lookups.size()]) != map.end()) ++found;
+    }
+    printPerOperation(cout, name + "::find", counters.stop(), ops, counters.available());
+
+    uint64_t sum = 0;
+    size_t rounds = std::max<size_t>(1, ops / n);
+    counters.start();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (typename Map::iterator it = map.begin(); it != map.end(); ++it) {
+            sum += (*it).second;
+        }
+    }
+    printPerOperation(cout, name + "::iterator::operator++", counters.stop(), rounds * n, counters.available());
+    sink = found + sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = 4000000;
+    if (argc > 1) {
+        ops = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    const size_t sizes[] = { 8, 32, 64, 1000, 100000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        cout << "n = " << sizes[i] << endl;
+        printPerOperationHeader(cout);
+        benchMap<AVLTree<uint32_t, uint32_t> >("AVLTree", sizes[i], ops);
+        benchMap<HybridMap<uint32_t, uint32_t> >("HybridMap", sizes[i], ops);
+        cout << endl;
+    }
+
+    // a map that grows past the threshold and shrinks back, many times
+    PerfCounters counters;
+    HybridMap<uint32_t, uint32_t> churn;
+    size_t cycles = ops / 1000;
+    counters.start();
+    for (size_t c = 0; c < cycles; ++c) {
+        for (uint32_t k = 0; k < 100; ++k) {
+            churn.insert(std::make_pair(k, k));
+        }
+        for (uint32_t k = 0; k < 100; ++k) {
+            churn.remove(k);
+        }
+    }
+    printPerOperationHeader(cout);
+    printPerOperation(cout, "HybridMap grow to 100 and back", counters.stop(), cycles * 200, counters.available());
+
+    return 0;
+}
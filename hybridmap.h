@@ -0,0 +1,507 @@
+#ifndef HYBRIDMAP_H
+#define HYBRIDMAP_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* A map that keeps its items in two sorted arrays, keys and values, while it
+* is small and in an AVLTree once it grows.
+*
+* Up to promoteAbove items the keys sit next to each other in memory and
+* are searched with a binary search whose loop has no data-dependent
+* branch; iteration is a walk over two arrays.  The insert that would take
+* the map past promoteAbove moves every item into a minimum-height AVLTree
+* in one O(n) pass, and once removals take it below demoteBelow it moves
+* back the same way.  The gap between the two thresholds keeps a map that
+* hovers around one size from converting back and forth.
+*
+* Iterators give a proxy with first/second references instead of a
+* std::pair, since flat items are not stored as pairs.  Any insert or remove
+* invalidates all iterators.  Like CompactAVLTree, the map is not copyable.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class HybridMap
+{
+    static_assert(!std::is_same<Value, bool>::value,
+                  "HybridMap keeps values in a std::vector, which has no bool references");
+
+public:
+    HybridMap();
+    explicit HybridMap(const Compare& comp);
+    // Throws std::invalid_argument unless demoteBelow <= promoteAbove.
+    HybridMap(size_t promoteAbove, size_t demoteBelow, const Compare& comp = Compare());
+
+    // Overwrites the value if the key is already present.
+    void insert(const std::pair<const Key, Value>& new_item);
+    void remove(const Key& key);
+    void clear();
+    size_t size() const;
+    bool empty() const;
+    // Whether the items are currently in the sorted arrays.
+    bool isFlat() const;
+
+    struct reference
+    {
+        const Key& first;
+        Value& second;
+    };
+
+    class iterator
+    {
+    public:
+        // What operator-> returns: it holds the proxy, so that it->first works.
+        class pointer
+        {
+        public:
+            const reference* operator->() const { return &ref_; }
+        private:
+            friend class iterator;
+            explicit pointer(const reference& ref) : ref_(ref) {}
+            reference ref_;
+        };
+
+        iterator();
+
+        reference operator*() const;
+        pointer operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class HybridMap<Key, Value, Compare>;
+        typedef typename BinarySearchTree<Key, Value, Compare>::iterator TreeIterator;
+
+        iterator(HybridMap* map, size_t index);
+        iterator(HybridMap* map, TreeIterator it);
+        HybridMap* map_;
+        size_t index_;      // in flat mode
+        TreeIterator tree_; // in tree mode
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    bool contains(const Key& key) const;
+
+    /**
+     * @precondition The key exists in the map
+     * Returns the value associated with the key
+     */
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    /**
+    * The AVLTree used in tree mode, with the bulk operations the
+    * conversions need.
+    */
+    class Tree : public AVLTree<Key, Value, Compare>
+    {
+    public:
+        explicit Tree(const Compare& comp);
+        // Returns false if the key was already present and its value replaced.
+        bool insertItem(const std::pair<const Key, Value>& new_item);
+        // Returns false if there was no such key.
+        bool removeKey(const Key& key);
+        // Replaces the tree with the items of two parallel sorted arrays.
+        void assignSorted(const std::vector<Key>& keys, const std::vector<Value>& values);
+    };
+
+    // Index of the first flat key not less than key.
+    size_t flatLowerBound(const Key& key) const;
+    // Index of key among the flat keys, or keys_.size().
+    size_t flatFind(const Key& key) const;
+    bool less(const Key& lhs, const Key& rhs) const;
+    bool less(const Key& lhs, const Key& rhs, std::false_type threeWay) const;
+    bool less(const Key& lhs, const Key& rhs, std::true_type threeWay) const;
+
+    void promote();
+    void demote();
+
+    std::vector<Key> keys_;
+    std::vector<Value> values_;
+    Tree tree_;
+    size_t size_;
+    bool flat_;
+    size_t promoteAbove_;
+    size_t demoteBelow_;
+    Compare comp_;
+
+private:
+    HybridMap(const HybridMap&);
+    HybridMap& operator=(const HybridMap&);
+};
+
+/*
+-----------------------------------------
+Begin implementations for the HybridMap::Tree class.
+-----------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::Tree::Tree(const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::Tree::insertItem(const std::pair<const Key, Value>& new_item)
+{
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(new_item.first, parentNode, isLeft);
+    if (existing != NULL) {
+        existing->setValue(new_item.second);
+        return false;
+    }
+    this->insertAt(new_item, parentNode, isLeft);
+    return true;
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::Tree::removeKey(const Key& key)
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if (node == NULL) return false;
+    this->removeNode(node);
+    return true;
+}
+
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::Tree::assignSorted(const std::vector<Key>& keys,
+                                                        const std::vector<Value>& values)
+{
+    this->clear();
+    std::vector<AVLNode<Key, Value>*> nodes;
+    nodes.reserve(keys.size());
+    try {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            nodes.push_back(this->createNode(keys[i], values[i], NULL));
+        }
+    } catch (...) {
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            delete nodes[i];
+        }
+        throw;
+    }
+    this->buildFromSorted(nodes);
+}
+
+/*
+-----------------------------------------
+Begin implementations for the HybridMap::iterator class.
+-----------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::iterator::iterator() :
+    map_(NULL), index_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::iterator::iterator(HybridMap* map, size_t index) :
+    map_(map), index_(index)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::iterator::iterator(HybridMap* map, TreeIterator it) :
+    map_(map), index_(0), tree_(it)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::reference
+HybridMap<Key, Value, Compare>::iterator::operator*() const
+{
+    if (map_->flat_) {
+        reference ref = { map_->keys_[index_], map_->values_[index_] };
+        return ref;
+    }
+    reference ref = { tree_->first, tree_->second };
+    return ref;
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::iterator::pointer
+HybridMap<Key, Value, Compare>::iterator::operator->() const
+{
+    return pointer(**this);
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return index_ == rhs.index_ && tree_ == rhs.tree_;
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return !(*this == rhs);
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::iterator&
+HybridMap<Key, Value, Compare>::iterator::operator++()
+{
+    if (map_->flat_) {
+        ++index_;
+    } else {
+        ++tree_;
+    }
+    return *this;
+}
+
+/*
+-----------------------------------------
+Begin implementations for the HybridMap class.
+-----------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::HybridMap() :
+    tree_(Compare()), size_(0), flat_(true), promoteAbove_(64), demoteBelow_(16), comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::HybridMap(const Compare& comp) :
+    tree_(comp), size_(0), flat_(true), promoteAbove_(64), demoteBelow_(16), comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+HybridMap<Key, Value, Compare>::HybridMap(size_t promoteAbove, size_t demoteBelow, const Compare& comp) :
+    tree_(comp), size_(0), flat_(true), promoteAbove_(promoteAbove), demoteBelow_(demoteBelow), comp_(comp)
+{
+    if (demoteBelow > promoteAbove) {
+        throw std::invalid_argument("HybridMap: demoteBelow must not exceed promoteAbove");
+    }
+}
+
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::insert(const std::pair<const Key, Value>& new_item)
+{
+    if (flat_) {
+        size_t pos = flatLowerBound(new_item.first);
+        if (pos < keys_.size() && !less(new_item.first, keys_[pos])) {
+            values_[pos] = new_item.second;
+            return;
+        }
+        if (size_ < promoteAbove_) {
+            keys_.insert(keys_.begin() + pos, new_item.first);
+            try {
+                values_.insert(values_.begin() + pos, new_item.second);
+            } catch (...) {
+                keys_.erase(keys_.begin() + pos);
+                throw;
+            }
+            ++size_;
+            return;
+        }
+        promote();
+    }
+    if (tree_.insertItem(new_item)) ++size_;
+}
+
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::remove(const Key& key)
+{
+    if (flat_) {
+        size_t pos = flatFind(key);
+        if (pos == keys_.size()) return;
+        keys_.erase(keys_.begin() + pos);
+        values_.erase(values_.begin() + pos);
+        --size_;
+        return;
+    }
+    if (!tree_.removeKey(key)) return;
+    --size_;
+    if (size_ < demoteBelow_) demote();
+}
+
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::clear()
+{
+    keys_.clear();
+    values_.clear();
+    tree_.clear();
+    size_ = 0;
+    flat_ = true;
+}
+
+template<class Key, class Value, class Compare>
+size_t HybridMap<Key, Value, Compare>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::isFlat() const
+{
+    return flat_;
+}
+
+/**
+* Builds the tree first, so the arrays are untouched if that throws.
+*/
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::promote()
+{
+    tree_.assignSorted(keys_, values_);
+    keys_.clear();
+    values_.clear();
+    flat_ = false;
+}
+
+template<class Key, class Value, class Compare>
+void HybridMap<Key, Value, Compare>::demote()
+{
+    keys_.reserve(size_);
+    values_.reserve(size_);
+    try {
+        for (typename BinarySearchTree<Key, Value, Compare>::iterator it = tree_.begin(); it != tree_.end(); ++it) {
+            keys_.push_back(it->first);
+            values_.push_back(it->second);
+        }
+    } catch (...) {
+        keys_.clear();
+        values_.clear();
+        throw;
+    }
+    tree_.clear();
+    flat_ = true;
+}
+
+/**
+* Halves the candidate range without branching on the comparison: the
+* ternary compiles to a conditional move for simple keys, so the loop runs
+* the same log2(n) steps whatever the key and the branch predictor never
+* misses inside it.
+*/
+template<class Key, class Value, class Compare>
+size_t HybridMap<Key, Value, Compare>::flatLowerBound(const Key& key) const
+{
+    size_t n = keys_.size();
+    if (n == 0) return 0;
+    const Key* first = &keys_[0];
+    const Key* base = first;
+    while (n > 1) {
+        size_t half = n / 2;
+        base = less(base[half], key) ? base + half : base;
+        n -= half;
+    }
+    return (base - first) + (less(*base, key) ? 1 : 0);
+}
+
+template<class Key, class Value, class Compare>
+size_t HybridMap<Key, Value, Compare>::flatFind(const Key& key) const
+{
+    size_t pos = flatLowerBound(key);
+    if (pos < keys_.size() && !less(key, keys_[pos])) return pos;
+    return keys_.size();
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::less(const Key& lhs, const Key& rhs) const
+{
+    return less(lhs, rhs, IsThreeWayCompare<Compare, Key>());
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::less(const Key& lhs, const Key& rhs, std::false_type) const
+{
+    return comp_(lhs, rhs);
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::less(const Key& lhs, const Key& rhs, std::true_type) const
+{
+    return comp_(lhs, rhs) < 0;
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::iterator
+HybridMap<Key, Value, Compare>::begin() const
+{
+    HybridMap* self = const_cast<HybridMap*>(this);
+    if (flat_) return iterator(self, 0);
+    return iterator(self, tree_.begin());
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::iterator
+HybridMap<Key, Value, Compare>::end() const
+{
+    HybridMap* self = const_cast<HybridMap*>(this);
+    if (flat_) return iterator(self, keys_.size());
+    return iterator(self, tree_.end());
+}
+
+template<class Key, class Value, class Compare>
+typename HybridMap<Key, Value, Compare>::iterator
+HybridMap<Key, Value, Compare>::find(const Key& key) const
+{
+    HybridMap* self = const_cast<HybridMap*>(this);
+    if (flat_) return iterator(self, flatFind(key));
+    return iterator(self, tree_.find(key));
+}
+
+template<class Key, class Value, class Compare>
+size_t HybridMap<Key, Value, Compare>::count(const Key& key) const
+{
+    return contains(key) ? 1 : 0;
+}
+
+template<class Key, class Value, class Compare>
+bool HybridMap<Key, Value, Compare>::contains(const Key& key) const
+{
+    if (flat_) return flatFind(key) != keys_.size();
+    return tree_.contains(key);
+}
+
+template<class Key, class Value, class Compare>
+Value& HybridMap<Key, Value, Compare>::operator[](const Key& key)
+{
+    if (!flat_) return tree_[key];
+    size_t pos = flatFind(key);
+    if (pos == keys_.size()) throw std::out_of_range("Invalid key");
+    return values_[pos];
+}
+
+template<class Key, class Value, class Compare>
+Value const & HybridMap<Key, Value, Compare>::operator[](const Key& key) const
+{
+    if (!flat_) return tree_[key];
+    size_t pos = flatFind(key);
+    if (pos == keys_.size()) throw std::out_of_range("Invalid key");
+    return values_[pos];
+}
+
+#endif
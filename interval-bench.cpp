@@ -0,0 +1,83 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "intervaltree.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Answers the same overlap queries with IntervalTree::overlapping and with a
+ * full scan of an AVLTree holding the same intervals.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 200000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    const size_t queries = 2000;
+    const uint64_t span = 100 * (uint64_t)n;
+
+    std::mt19937_64 rng(105);
+    IntervalTree<uint64_t, uint64_t> intervals;
+    AVLTree<Interval<uint64_t>, uint64_t> plain;
+    PerfCounters counters;
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t low = rng() % span;
+        Interval<uint64_t> interval = { low, low + rng() % 1000 };
+        intervals.insert(std::make_pair(interval, (uint64_t)i));
+    }
+    PerfCounters::Sample insertSample = counters.stop();
+    for (IntervalTree<uint64_t, uint64_t>::iterator it = intervals.begin(); it != intervals.end(); ++it) {
+        plain.insert(*it);
+    }
+
+    vector<Interval<uint64_t> > windows(queries);
+    for (size_t i = 0; i < queries; ++i) {
+        windows[i].low = rng() % span;
+        windows[i].high = windows[i].low + rng() % 2000;
+    }
+
+    cout << "n = " << n << ", " << queries << " queries" << endl;
+    printPerOperationHeader(cout);
+    printPerOperation(cout, "IntervalTree::insert", insertSample, n, counters.available());
+
+    uint64_t treeHits = 0;
+    counters.start();
+    for (size_t q = 0; q < queries; ++q) {
+        treeHits += intervals.overlapping(windows[q].low, windows[q].high).size();
+    }
+    printPerOperation(cout, "IntervalTree::overlapping", counters.stop(), queries, counters.available());
+
+    uint64_t scanHits = 0;
+    counters.start();
+    for (size_t q = 0; q < queries / 20; ++q) {
+        for (AVLTree<Interval<uint64_t>, uint64_t>::iterator it = plain.begin(); it != plain.end(); ++it) {
+            if (!(it->first.high < windows[q].low) && !(windows[q].high < it->first.low)) ++scanHits;
+        }
+    }
+    printPerOperation(cout, "full scan", counters.stop(), queries / 20, counters.available());
+
+    uint64_t checkHits = 0;
+    for (size_t q = 0; q < queries / 20; ++q) {
+        checkHits += intervals.overlapping(windows[q].low, windows[q].high).size();
+    }
+    if (checkHits != scanHits) {
+        cout << "mismatch: " << checkHits << " vs " << scanHits << endl;
+        return 1;
+    }
+    cout << "average matches per query: " << (double)treeHits / queries << endl;
+    sink = treeHits + scanHits;
+    return 0;
+}
@@ -0,0 +1,250 @@
+#ifndef INTERVALTREE_H
+#define INTERVALTREE_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* A closed interval [low, high], ordered by low and then high.  It is
+* trivially copyable whenever Point is, so interval trees can be saved.
+*/
+template <typename Point>
+struct Interval
+{
+    Point low;
+    Point high;
+};
+
+template <typename Point>
+bool operator<(const Interval<Point>& lhs, const Interval<Point>& rhs)
+{
+    if (lhs.low < rhs.low) return true;
+    if (rhs.low < lhs.low) return false;
+    return lhs.high < rhs.high;
+}
+
+template <typename Point>
+bool operator==(const Interval<Point>& lhs, const Interval<Point>& rhs)
+{
+    return !(lhs < rhs) && !(rhs < lhs);
+}
+
+template <typename Point>
+std::ostream& operator<<(std::ostream& out, const Interval<Point>& interval)
+{
+    return out << "[" << interval.low << ", " << interval.high << "]";
+}
+
+/**
+* An AVLNode keyed by an interval that also stores the largest high
+* endpoint in its subtree.
+*/
+template <typename Point, typename Value>
+class IntervalNode : public AVLNode<Interval<Point>, Value>
+{
+public:
+    IntervalNode(const Interval<Point>& key, const Value& value,
+                 AVLNode<Interval<Point>, Value>* parent);
+    virtual ~IntervalNode();
+    virtual Node<Interval<Point>, Value>* clone() const;
+
+    const Point& getMaxHigh() const;
+    void setMaxHigh(const Point& maxHigh);
+
+protected:
+    Point maxHigh_;
+};
+
+template<class Point, class Value>
+IntervalNode<Point, Value>::IntervalNode(const Interval<Point>& key, const Value& value,
+                                         AVLNode<Interval<Point>, Value>* parent) :
+    AVLNode<Interval<Point>, Value>(key, value, parent), maxHigh_(key.high)
+{
+
+}
+
+template<class Point, class Value>
+IntervalNode<Point, Value>::~IntervalNode()
+{
+
+}
+
+template<class Point, class Value>
+Node<Interval<Point>, Value>* IntervalNode<Point, Value>::clone() const
+{
+    return new IntervalNode<Point, Value>(*this);
+}
+
+template<class Point, class Value>
+const Point& IntervalNode<Point, Value>::getMaxHigh() const
+{
+    return maxHigh_;
+}
+
+template<class Point, class Value>
+void IntervalNode<Point, Value>::setMaxHigh(const Point& maxHigh)
+{
+    maxHigh_ = maxHigh;
+}
+
+/**
+* An AVL tree of closed intervals, in Interval order, where each node
+* knows the largest high endpoint below it.  That lets overlap queries skip
+* every subtree whose intervals all end before the query starts, and stop at
+* the first interval starting after the query ends.
+*
+* A query visits O(log n) nodes plus the nodes on the paths to the k
+* intervals it reports: O(log n + k) when the matches are adjacent in the
+* tree and O(log n + k log(n / k)) when they are scattered.
+*
+* The maximum is kept up to date through the AVLTree hooks: rotations call
+* updateNode on the nodes they move, and insert and remove (including the
+* predecessor swap) finish with a walk from the changed position to the root.
+*/
+template <class Point, class Value>
+class IntervalTree : public AVLTree<Interval<Point>, Value>
+{
+public:
+    typedef typename BinarySearchTree<Interval<Point>, Value>::iterator iterator;
+    typedef typename AVLTree<Interval<Point>, Value>::NodeHandle NodeHandle;
+
+    IntervalTree();
+
+    /*
+     * Throws std::invalid_argument if the interval's low end is above its
+     * high end.
+     */
+    virtual void insert (const std::pair<const Interval<Point>, Value> &new_item);
+    // A handle's key cannot change and only an IntervalTree's handle is
+    // accepted, so its interval was checked when it was first inserted.
+    using AVLTree<Interval<Point>, Value>::insert;
+
+    // Every interval intersecting [low, high], in tree order.
+    std::vector<iterator> overlapping(const Point& low, const Point& high) const;
+    // Every interval containing point.
+    std::vector<iterator> stabbing(const Point& point) const;
+
+    // Checks every node's stored maximum against its subtree.
+    bool isValidMaxHigh() const;
+
+protected:
+    typedef IntervalNode<Point, Value> INode;
+    typedef AVLNode<Interval<Point>, Value> ANode;
+
+    virtual ANode* createNode(const Interval<Point>& key, const Value& value, ANode* parent);
+    virtual void updateNode(ANode* node);
+    virtual void afterInsert(ANode* node);
+    virtual void afterRemove(ANode* parent);
+
+    void collect(INode* node, const Point& low, const Point& high, std::vector<iterator>& out) const;
+    bool checkMaxHigh(INode* node) const;
+};
+
+template<class Point, class Value>
+IntervalTree<Point, Value>::IntervalTree() :
+    AVLTree<Interval<Point>, Value>()
+{
+
+}
+
+template<class Point, class Value>
+typename IntervalTree<Point, Value>::ANode*
+IntervalTree<Point, Value>::createNode(const Interval<Point>& key, const Value& value, ANode* parent)
+{
+    return new INode(key, value, parent);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::insert (const std::pair<const Interval<Point>, Value> &new_item)
+{
+    if (new_item.first.high < new_item.first.low) {
+        throw std::invalid_argument("IntervalTree: interval ends before it starts");
+    }
+    AVLTree<Interval<Point>, Value>::insert(new_item);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::updateNode(ANode* node)
+{
+    INode* inode = static_cast<INode*>(node);
+    Point maxHigh = inode->getKey().high;
+    INode* left = static_cast<INode*>(inode->getLeft());
+    INode* right = static_cast<INode*>(inode->getRight());
+    if (left != NULL && maxHigh < left->getMaxHigh()) maxHigh = left->getMaxHigh();
+    if (right != NULL && maxHigh < right->getMaxHigh()) maxHigh = right->getMaxHigh();
+    inode->setMaxHigh(maxHigh);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::afterInsert(ANode* node)
+{
+    this->updatePathToRoot(node);
+}
+
+template<class Point, class Value>
+void IntervalTree<Point, Value>::afterRemove(ANode* parent)
+{
+    this->updatePathToRoot(parent);
+}
+
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::overlapping(const Point& low, const Point& high) const
+{
+    std::vector<iterator> out;
+    collect(static_cast<INode*>(this->root_), low, high, out);
+    return out;
+}
+
+template<class Point, class Value>
+std::vector<typename IntervalTree<Point, Value>::iterator>
+IntervalTree<Point, Value>::stabbing(const Point& point) const
+{
+    return overlapping(point, point);
+}
+
+/**
+* In-order walk that prunes subtrees ending before low and stops at the
+* first interval starting after high.
+*/
+template<class Point, class Value>
+void IntervalTree<Point, Value>::collect(INode* node, const Point& low, const Point& high,
+                                         std::vector<iterator>& out) const
+{
+    if (node == NULL || node->getMaxHigh() < low) return;
+
+    collect(static_cast<INode*>(node->getLeft()), low, high, out);
+    const Interval<Point>& interval = node->getKey();
+    if (high < interval.low) return;
+    if (!(interval.high < low)) {
+        out.push_back(this->iteratorAt(node));
+    }
+    collect(static_cast<INode*>(node->getRight()), low, high, out);
+}
+
+template<class Point, class Value>
+bool IntervalTree<Point, Value>::checkMaxHigh(INode* node) const
+{
+    if (node == NULL) return true;
+    INode* left = static_cast<INode*>(node->getLeft());
+    INode* right = static_cast<INode*>(node->getRight());
+    if (!checkMaxHigh(left) || !checkMaxHigh(right)) return false;
+
+    Point expected = node->getKey().high;
+    if (left != NULL && expected < left->getMaxHigh()) expected = left->getMaxHigh();
+    if (right != NULL && expected < right->getMaxHigh()) expected = right->getMaxHigh();
+    return !(expected < node->getMaxHigh()) && !(node->getMaxHigh() < expected);
+}
+
+template<class Point, class Value>
+bool IntervalTree<Point, Value>::isValidMaxHigh() const
+{
+    return checkMaxHigh(static_cast<INode*>(this->root_));
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "lazyavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Expires a batch of keys and reinserts them, then expires a larger batch
+ * for good, which pushes LazyAVLTree through compaction.
+ */
+template<typename Tree>
+void benchTree(const string& name, Tree& tree, const vector<uint64_t>& keys, size_t batch)
+{
+    PerfCounters counters;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    counters.start();
+    for (size_t round = 0; round < 4; ++round) {
+        size_t first = round * batch;
+        for (size_t i = first; i < first + batch; ++i) {
+            tree.remove(keys[i]);
+        }
+        for (size_t i = first; i < first + batch; ++i) {
+            tree.insert(std::make_pair(keys[i], keys[i] + 1));
+        }
+    }
+    printPerOperation(cout, name + " expire + reinsert", counters.stop(), 8 * batch, counters.available());
+
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (tree.find(keys[i]) != tree.end()) ++found;
+    }
+    printPerOperation(cout, name + "::find", counters.stop(), keys.size(), counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < keys.size() / 2; ++i) {
+        tree.remove(keys[i]);
+    }
+    printPerOperation(cout, name + "::remove half", counters.stop(), keys.size() / 2, counters.available());
+
+    uint64_t sum = 0;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    sink = found + sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    size_t batch = n / 10;
+
+    cout << "n = " << n << ", expiry batch = " << batch << endl;
+    printPerOperationHeader(cout);
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        benchTree("AVLTree", tree, keys, batch);
+    }
+    {
+        LazyAVLTree<uint64_t, uint64_t> tree(0.25);
+        benchTree("LazyAVLTree(0.25)", tree, keys, batch);
+    }
+    {
+        // never compacts, to show the cost of marking alone
+        LazyAVLTree<uint64_t, uint64_t> tree(1.0);
+        benchTree("LazyAVLTree(1.0)", tree, keys, batch);
+    }
+
+    return 0;
+}
@@ -0,0 +1,580 @@
+#ifndef LAZYAVL_H
+#define LAZYAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <vector>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* An AVLNode with a tombstone flag.
+*/
+template <typename Key, typename Value>
+class LazyAVLNode : public AVLNode<Key, Value>
+{
+public:
+    LazyAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~LazyAVLNode();
+    virtual Node<Key, Value>* clone() const;
+
+    bool isDead() const;
+    void setDead(bool dead);
+
+protected:
+    bool dead_;
+};
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>::LazyAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), dead_(false)
+{
+
+}
+
+template<class Key, class Value>
+LazyAVLNode<Key, Value>::~LazyAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+Node<Key, Value>* LazyAVLNode<Key, Value>::clone() const
+{
+    return new LazyAVLNode<Key, Value>(*this);
+}
+
+template<class Key, class Value>
+bool LazyAVLNode<Key, Value>::isDead() const
+{
+    return dead_;
+}
+
+template<class Key, class Value>
+void LazyAVLNode<Key, Value>::setDead(bool dead)
+{
+    dead_ = dead;
+}
+
+/**
+* An AVLTree whose remove only marks the node dead.  Inserting the key again
+* revives the node in place, so expiring a batch of keys and reinserting them
+* costs a search each and no restructuring.
+*
+* Once more than maxDeadFraction of the nodes are dead, one compaction pass
+* deletes the dead nodes and relinks the live ones into a minimum-height tree
+* (AVLTree::buildFromSorted) without allocating or comparing.
+*
+* The lookup and iteration functions below skip dead nodes.  They hide the
+* ones in BinarySearchTree, including the transparent overloads, so use the
+* tree through a LazyAVLTree, not through a base class reference.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class LazyAVLTree : public AVLTree<Key, Value, Compare>
+{
+public:
+    explicit LazyAVLTree(double maxDeadFraction = 0.25);
+    LazyAVLTree(double maxDeadFraction, const Compare& comp);
+    // The counts of live and dead nodes travel with the nodes.
+    LazyAVLTree(const LazyAVLTree& other);
+    LazyAVLTree(LazyAVLTree&& other);
+    LazyAVLTree& operator=(const LazyAVLTree& other);
+    LazyAVLTree& operator=(LazyAVLTree&& other);
+
+    typedef typename AVLTree<Key, Value, Compare>::NodeHandle NodeHandle;
+
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    virtual void clear();
+    // Writes only the live items; AVLTree::load reads the file back.  Not
+    // virtual, as save only compiles for keys and values with a Serializer.
+    void save(const std::string& path) const;
+    bool empty() const;
+    size_t size() const;
+    size_t deadCount() const;
+
+    // Physically removes every dead node now.
+    void compact();
+
+    /**
+    * An iterator over the live items.
+    */
+    class iterator : public BinarySearchTree<Key, Value, Compare>::iterator
+    {
+    public:
+        iterator();
+        iterator& operator++();
+
+    protected:
+        friend class LazyAVLTree<Key, Value, Compare>;
+        explicit iterator(Node<Key, Value>* ptr);
+        void skipDead();
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    bool contains(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    // Only live items can be extracted; a dead key gives an empty handle.
+    NodeHandle extract(const Key& key);
+    NodeHandle extract(iterator pos);
+    // Replaces the item with an equal key, live or dead, like insert.
+    iterator insert(NodeHandle&& handle);
+
+protected:
+    typedef LazyAVLNode<Key, Value> LazyNode;
+
+    virtual AVLNode<Key, Value>* createNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual void removeNode(Node<Key, Value>* target);
+    virtual void beforeMerge(AVLTree<Key, Value, Compare>& other);
+    virtual void afterMerge(size_t added);
+    virtual bool hidden(const Node<Key, Value>* node) const;
+    LazyNode* liveNode(const Key& key) const;
+    static void saveRange(std::ostream& out, const std::vector<Node<Key, Value>*>& live, size_t lo, size_t hi);
+    static bool dead(Node<Key, Value>* node);
+
+    double maxDeadFraction_;
+    // atomic since createNode counts here, and AVLTree::buildFromUnsorted
+    // calls createNode from several threads
+    std::atomic<size_t> nodeCount_;
+    size_t deadCount_;
+};
+
+/*
+-----------------------------------------------------------
+Begin implementations for the LazyAVLTree::iterator class.
+-----------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::iterator::iterator() :
+    BinarySearchTree<Key, Value, Compare>::iterator()
+{
+
+}
+
+/**
+* Starts at ptr, or at the first live node after it.
+*/
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::iterator::iterator(Node<Key, Value>* ptr) :
+    BinarySearchTree<Key, Value, Compare>::iterator(ptr)
+{
+    skipDead();
+}
+
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::iterator::skipDead()
+{
+    while (this->current_ != NULL && dead(this->current_)) {
+        BinarySearchTree<Key, Value, Compare>::iterator::operator++();
+    }
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator&
+LazyAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    BinarySearchTree<Key, Value, Compare>::iterator::operator++();
+    skipDead();
+    return *this;
+}
+
+/*
+---------------------------------------------------------
+End implementations for the LazyAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::LazyAVLTree(double maxDeadFraction) :
+    AVLTree<Key, Value, Compare>(),
+    maxDeadFraction_(maxDeadFraction),
+    nodeCount_(0),
+    deadCount_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::LazyAVLTree(double maxDeadFraction, const Compare& comp) :
+    AVLTree<Key, Value, Compare>(comp),
+    maxDeadFraction_(maxDeadFraction),
+    nodeCount_(0),
+    deadCount_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::LazyAVLTree(const LazyAVLTree& other) :
+    AVLTree<Key, Value, Compare>(other),
+    maxDeadFraction_(other.maxDeadFraction_),
+    nodeCount_(other.nodeCount_.load()),
+    deadCount_(other.deadCount_)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>::LazyAVLTree(LazyAVLTree&& other) :
+    AVLTree<Key, Value, Compare>(std::move(other)),
+    maxDeadFraction_(other.maxDeadFraction_),
+    nodeCount_(other.nodeCount_.load()),
+    deadCount_(other.deadCount_)
+{
+    other.nodeCount_ = 0;
+    other.deadCount_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>& LazyAVLTree<Key, Value, Compare>::operator=(const LazyAVLTree& other)
+{
+    AVLTree<Key, Value, Compare>::operator=(other);
+    maxDeadFraction_ = other.maxDeadFraction_;
+    nodeCount_ = other.nodeCount_.load();
+    deadCount_ = other.deadCount_;
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+LazyAVLTree<Key, Value, Compare>& LazyAVLTree<Key, Value, Compare>::operator=(LazyAVLTree&& other)
+{
+    if (this == &other) return *this;
+    AVLTree<Key, Value, Compare>::operator=(std::move(other));
+    maxDeadFraction_ = other.maxDeadFraction_;
+    nodeCount_ = other.nodeCount_.load();
+    deadCount_ = other.deadCount_;
+    other.nodeCount_ = 0;
+    other.deadCount_ = 0;
+    return *this;
+}
+
+template<class Key, class Value, class Compare>
+bool LazyAVLTree<Key, Value, Compare>::dead(Node<Key, Value>* node)
+{
+    return static_cast<LazyNode*>(node)->isDead();
+}
+
+template<class Key, class Value, class Compare>
+bool LazyAVLTree<Key, Value, Compare>::hidden(const Node<Key, Value>* node) const
+{
+    return static_cast<const LazyNode*>(node)->isDead();
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, Value>* LazyAVLTree<Key, Value, Compare>::createNode(const Key& key, const Value& value,
+                                                                  AVLNode<Key, Value>* parent)
+{
+    nodeCount_.fetch_add(1, std::memory_order_relaxed);
+    return new LazyNode(key, value, parent);
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten, and a
+ * dead node is revived.
+ */
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(new_item.first, parentNode, isLeft);
+    if (existing == NULL) {
+        this->insertAt(new_item, parentNode, isLeft);
+        return;
+    }
+
+    existing->setValue(new_item.second);
+    if (dead(existing)) {
+        static_cast<LazyNode*>(existing)->setDead(false);
+        --deadCount_;
+    }
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::NodeHandle
+LazyAVLTree<Key, Value, Compare>::extract(const Key& key)
+{
+    LazyNode* node = liveNode(key);
+    if (node == NULL) return NodeHandle();
+    this->unlinkNode(node);
+    --nodeCount_;
+    return this->handleFor(node);
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::NodeHandle
+LazyAVLTree<Key, Value, Compare>::extract(iterator pos)
+{
+    AVLNode<Key, Value>* node = static_cast<AVLNode<Key, Value>*>(this->nodeAt(pos));
+    if (node == NULL) throw std::out_of_range("LazyAVLTree::extract: end iterator");
+    this->unlinkNode(node);
+    --nodeCount_;
+    return this->handleFor(node);
+}
+
+/**
+* The handle's node takes over the place of a dead node with the same key
+* rather than reviving it, so the dead node is deleted here.
+*/
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::insert(NodeHandle&& handle)
+{
+    if (handle.empty()) return end();
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(handle.key(), parentNode, isLeft);
+    AVLNode<Key, Value>* node = this->takeNode(handle);
+    static_cast<LazyNode*>(node)->setDead(false);
+    if (existing == NULL) {
+        this->linkNode(node, parentNode, isLeft);
+        ++nodeCount_;
+    } else {
+        if (dead(existing)) --deadCount_;
+        AVLNode<Key, Value>* old = static_cast<AVLNode<Key, Value>*>(existing);
+        this->replaceNode(old, node);
+        delete old;
+    }
+    return iterator(node);
+}
+
+/**
+* merge works on physical nodes, so both trees drop their dead nodes first
+* (compact may allocate its scratch vectors).  merge has checked that other
+* is a LazyAVLTree too.
+*/
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::beforeMerge(AVLTree<Key, Value, Compare>& other)
+{
+    LazyAVLTree& lazyOther = static_cast<LazyAVLTree&>(other);
+    compact();
+    lazyOther.compact();
+    lazyOther.nodeCount_ = 0;
+    lazyOther.deadCount_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::afterMerge(size_t added)
+{
+    nodeCount_ = this->root_ == NULL ? 0 : nodeCount_.load() + added;
+}
+
+/**
+* Marks the node dead, compacting once the dead fraction passes the limit.
+*/
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::removeNode(Node<Key, Value>* target)
+{
+    if (target == NULL || dead(target)) return;
+
+    static_cast<LazyNode*>(target)->setDead(true);
+    ++deadCount_;
+    if ((double)deadCount_ > maxDeadFraction_ * (double)nodeCount_) {
+        compact();
+    }
+}
+
+/**
+* Collects the nodes in order, deletes the dead ones and relinks the rest.
+* The walk uses the parent links, so it needs no stack.
+*/
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::compact()
+{
+    if (deadCount_ == 0) return;
+
+    std::vector<AVLNode<Key, Value>*> live;
+    live.reserve(nodeCount_ - deadCount_);
+    std::vector<Node<Key, Value>*> doomed;
+    doomed.reserve(deadCount_);
+
+    Node<Key, Value>* node = this->getSmallestNode();
+    while (node != NULL) {
+        if (dead(node)) {
+            doomed.push_back(node);
+        } else {
+            live.push_back(static_cast<AVLNode<Key, Value>*>(node));
+        }
+
+        // step to the successor; dead nodes are only deleted afterwards
+        // since the climb below may pass through them
+        if (node->getRight() != NULL) {
+            node = node->getRight();
+            while (node->getLeft() != NULL) {
+                node = node->getLeft();
+            }
+        } else {
+            Node<Key, Value>* parent = node->getParent();
+            while (parent != NULL && node == parent->getRight()) {
+                node = parent;
+                parent = parent->getParent();
+            }
+            node = parent;
+        }
+    }
+
+    for (size_t i = 0; i < doomed.size(); ++i) {
+        delete doomed[i];
+    }
+    this->buildFromSorted(live);
+    nodeCount_ = live.size();
+    deadCount_ = 0;
+}
+
+/**
+* A tree with tombstones cannot be written as it stands, since load would
+* bring the dead items back.  Instead the live items are written with the
+* heights of the minimum-height tree buildFromSorted would link them into,
+* which is what compact would leave, without changing this tree.
+*/
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::save(const std::string& path) const
+{
+    if (deadCount_ == 0) {
+        AVLTree<Key, Value, Compare>::save(path);
+        return;
+    }
+
+    std::vector<Node<Key, Value>*> live;
+    live.reserve(size());
+    for (iterator it = begin(); it != end(); ++it) {
+        live.push_back(this->nodeAt(it));
+    }
+    std::ofstream out;
+    this->startSnapshot(out, path);
+    saveRange(out, live, 0, live.size());
+    this->finishSnapshot(out, path, live.size());
+}
+
+/**
+* Writes live[lo, hi) in order with the middle item as the subtree root; a
+* minimum-height tree of s nodes has height bit_length(s).
+*/
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::saveRange(std::ostream& out, const std::vector<Node<Key, Value>*>& live,
+                                                 size_t lo, size_t hi)
+{
+    if (lo == hi) return;
+    size_t mid = lo + (hi - lo) / 2;
+    saveRange(out, live, lo, mid);
+    int height = 0;
+    for (size_t size = hi - lo; size != 0; size >>= 1) ++height;
+    AVLTree<Key, Value, Compare>::writeSnapshotEntry(out, height, live[mid]);
+    saveRange(out, live, mid + 1, hi);
+}
+
+template<class Key, class Value, class Compare>
+void LazyAVLTree<Key, Value, Compare>::clear()
+{
+    BinarySearchTree<Key, Value, Compare>::clear();
+    nodeCount_ = 0;
+    deadCount_ = 0;
+}
+
+template<class Key, class Value, class Compare>
+bool LazyAVLTree<Key, Value, Compare>::empty() const
+{
+    return nodeCount_ == deadCount_;
+}
+
+template<class Key, class Value, class Compare>
+size_t LazyAVLTree<Key, Value, Compare>::size() const
+{
+    return nodeCount_ - deadCount_;
+}
+
+template<class Key, class Value, class Compare>
+size_t LazyAVLTree<Key, Value, Compare>::deadCount() const
+{
+    return deadCount_;
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::LazyNode*
+LazyAVLTree<Key, Value, Compare>::liveNode(const Key& key) const
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if (node == NULL || dead(node)) return NULL;
+    return static_cast<LazyNode*>(node);
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::begin() const
+{
+    return iterator(this->getSmallestNode());
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator();
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    return iterator(liveNode(key));
+}
+
+template<class Key, class Value, class Compare>
+size_t LazyAVLTree<Key, Value, Compare>::count(const Key& key) const
+{
+    return liveNode(key) == NULL ? 0 : 1;
+}
+
+template<class Key, class Value, class Compare>
+bool LazyAVLTree<Key, Value, Compare>::contains(const Key& key) const
+{
+    return liveNode(key) != NULL;
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(this->lowerBoundNode(key));
+}
+
+template<class Key, class Value, class Compare>
+typename LazyAVLTree<Key, Value, Compare>::iterator
+LazyAVLTree<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return iterator(this->upperBoundNode(key));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& LazyAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    LazyNode* node = liveNode(key);
+    if (node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Compare>
+Value const & LazyAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    LazyNode* node = liveNode(key);
+    if (node == NULL) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "mappedavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Compares startup of a MappedAVLTree (map the file and search) with
+ * reloading an AVLTree snapshot, then the steady-state find cost of both.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    string dir = ".";
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        dir = argv[2];
+    }
+    string mappedPath = dir + "/mapped-bench.avlm";
+    string snapshotPath = dir + "/mapped-bench.avls";
+    std::remove(mappedPath.c_str());
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i * 7;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    PerfCounters counters;
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+
+    {
+        MappedAVLTree<uint64_t, uint64_t> mapped(mappedPath);
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            mapped.insert(std::make_pair(keys[i], keys[i] + 1));
+        }
+        printPerOperation(cout, "MappedAVLTree::insert", counters.stop(), n, counters.available());
+
+        counters.start();
+        mapped.sync();
+        printPerOperation(cout, "MappedAVLTree::sync (whole file)", counters.stop(), 1, counters.available());
+    }
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        for (size_t i = 0; i < n; ++i) {
+            tree.insert(std::make_pair(keys[i], keys[i] + 1));
+        }
+        tree.save(snapshotPath);
+    }
+
+    uint64_t found = 0;
+
+    // startup: everything needed before the first answer
+    counters.start();
+    MappedAVLTree<uint64_t, uint64_t> mapped(mappedPath);
+    found += mapped.count(lookups[0]);
+    printPerOperation(cout, "MappedAVLTree open + first find", counters.stop(), 1, counters.available());
+
+    counters.start();
+    AVLTree<uint64_t, uint64_t> loaded;
+    loaded.load(snapshotPath);
+    found += loaded.count(lookups[0]);
+    printPerOperation(cout, "AVLTree::load + first find", counters.stop(), 1, counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        if (mapped.find(lookups[i]) != mapped.end()) ++found;
+    }
+    printPerOperation(cout, "MappedAVLTree::find", counters.stop(), n, counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        if (loaded.find(lookups[i]) != loaded.end()) ++found;
+    }
+    printPerOperation(cout, "AVLTree::find", counters.stop(), n, counters.available());
+
+    sink = found;
+    if (found != 2 * n + 2 || !mapped.isBalanced()) {
+        cout << "mapped tree does not match" << endl;
+        return 1;
+    }
+
+    std::remove(mappedPath.c_str());
+    std::remove(snapshotPath.c_str());
+    return 0;
+}
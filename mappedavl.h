@@ -0,0 +1,240 @@
+#ifndef MAPPEDAVL_H
+#define MAPPEDAVL_H
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "compactavl.h"
+
+/**
+* A CompactAVLTree whose slots live in a file mapped with mmap.
+*
+* Nodes link to each other by slot index, which is an offset from the start
+* of the slot array rather than an address, so the file can be mapped
+* anywhere.  Opening an existing file only maps it: there is nothing to
+* deserialize, and pages are faulted in as find() touches them.
+*
+* Updates write straight into the shared mapping.  sync() flushes them to
+* disk; without it they still reach the file through the page cache, but
+* are lost if the machine goes down.  Writes are not atomic, so a crash in
+* the middle of an update can leave the file inconsistent.
+*
+* The file is only portable between builds with the same Key, Value and
+* Index layout and byte order, and must always be opened with the same
+* Compare.  Only trivially copyable keys and values are supported.
+*/
+
+/**
+* What the file starts with.  The slot array follows at SLOTS_OFFSET.
+*/
+template <typename Index>
+struct MappedFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t slotSize;
+    uint32_t indexSize;
+    uint32_t reserved;
+    CompactHeader<Index> tree;
+};
+
+/**
+* Storage policy that keeps the header and slots in a shared file mapping,
+* growing the file with ftruncate and remapping it.
+*/
+struct MappedSlots
+{
+    template <typename Slot>
+    class storage
+    {
+    public:
+        typedef typename Slot::index_type index_type;
+        typedef MappedFileHeader<index_type> FileHeader;
+
+        // slots start on a cache line boundary after the header
+        static const size_t SLOTS_OFFSET = (sizeof(FileHeader) + 63) / 64 * 64;
+        static const size_t MIN_SLOTS = 1024;
+
+        /**
+        * Opens or creates the file at path.  Throws std::runtime_error on
+        * I/O errors or if the file was written for a different layout.
+        */
+        explicit storage(const std::string& path) : fd_(-1), base_(NULL), mappedSize_(0), capacity_(0)
+        {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd_ < 0) fail("cannot open " + path);
+            try {
+                openFile(path);
+            } catch (...) {
+                // the destructor will not run
+                unmap();
+                ::close(fd_);
+                throw;
+            }
+        }
+
+        ~storage()
+        {
+            unmap();
+            ::close(fd_);
+        }
+
+        CompactHeader<index_type>& header() { return fileHeader().tree; }
+        const CompactHeader<index_type>& header() const
+        {
+            return reinterpret_cast<const FileHeader*>(base_)->tree;
+        }
+        Slot* slots() const
+        {
+            return reinterpret_cast<Slot*>(static_cast<char*>(base_) + SLOTS_OFFSET);
+        }
+        size_t capacity() const { return capacity_; }
+
+        // Grows the file to hold at least n slots.  The slots are plain data
+        // already in the file, so nothing is relocated; only the mapping moves.
+        void reserve(size_t n)
+        {
+            if (n <= capacity_) return;
+            size_t minimum = MIN_SLOTS;
+            size_t newCapacity = std::max(n, std::max(capacity_ * 2, minimum));
+            remap(SLOTS_OFFSET + newCapacity * sizeof(Slot));
+        }
+
+        // Shrinks the file back to an empty tree after clear().
+        void release()
+        {
+            remap(SLOTS_OFFSET);
+        }
+
+        // Flushes the mapping to disk.
+        void sync()
+        {
+            if (::msync(base_, mappedSize_, MS_SYNC) != 0) fail("msync failed");
+        }
+
+    private:
+        storage(const storage&);
+        storage& operator=(const storage&);
+
+        // Maps an existing file, or lays out an empty tree in a new one.
+        void openFile(const std::string& path)
+        {
+            struct stat st;
+            if (::fstat(fd_, &st) != 0) fail("cannot stat " + path);
+
+            if (st.st_size == 0) {
+                remap(SLOTS_OFFSET);
+                FileHeader& fh = fileHeader();
+                std::memcpy(fh.magic, "AVLMAP1", 8);
+                fh.version = 1;
+                fh.slotSize = sizeof(Slot);
+                fh.indexSize = sizeof(index_type);
+                fh.reserved = 0;
+                fh.tree.root = 0;
+                fh.tree.freeList = 0;
+                fh.tree.used = 0;
+                fh.tree.count = 0;
+                return;
+            }
+
+            if ((size_t)st.st_size < SLOTS_OFFSET) fail(path + " is not a mapped AVL tree", false);
+            mapFile((size_t)st.st_size);
+            FileHeader& fh = fileHeader();
+            if (std::memcmp(fh.magic, "AVLMAP1", 8) != 0 || fh.version != 1) {
+                fail(path + " is not a mapped AVL tree", false);
+            }
+            if (fh.slotSize != sizeof(Slot) || fh.indexSize != sizeof(index_type)) {
+                fail(path + " was written for a different key/value layout", false);
+            }
+            if ((size_t)fh.tree.used > capacity_ || fh.tree.root > fh.tree.used || fh.tree.freeList > fh.tree.used) {
+                fail(path + " is truncated or corrupt", false);
+            }
+        }
+
+        FileHeader& fileHeader()
+        {
+            return *reinterpret_cast<FileHeader*>(base_);
+        }
+
+        // Resizes the file and maps it again.  The new mapping is made before
+        // the old one is dropped, so a failure leaves the tree usable.
+        void remap(size_t size)
+        {
+            size_t oldSize = mappedSize_;
+            if (size > oldSize && ::ftruncate(fd_, (off_t)size) != 0) fail("ftruncate failed");
+            void* base = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED) fail("mmap failed");
+            unmap();
+            setMapping(base, size);
+            if (size < oldSize && ::ftruncate(fd_, (off_t)size) != 0) fail("ftruncate failed");
+        }
+
+        void mapFile(size_t size)
+        {
+            void* base = ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (base == MAP_FAILED) fail("mmap failed");
+            setMapping(base, size);
+        }
+
+        void setMapping(void* base, size_t size)
+        {
+            base_ = base;
+            mappedSize_ = size;
+            capacity_ = (size - SLOTS_OFFSET) / sizeof(Slot);
+        }
+
+        void unmap()
+        {
+            if (base_ != NULL) ::munmap(base_, mappedSize_);
+            base_ = NULL;
+            mappedSize_ = 0;
+            capacity_ = 0;
+        }
+
+        void fail(const std::string& what, bool withErrno = true)
+        {
+            std::string message = "MappedAVLTree: " + what;
+            if (withErrno) message += std::string(": ") + std::strerror(errno);
+            throw std::runtime_error(message);
+        }
+
+        int fd_;
+        void* base_;
+        size_t mappedSize_;
+        size_t capacity_;
+    };
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>, typename Index = uint32_t>
+class MappedAVLTree : public CompactAVLTree<Key, Value, Compare, Index, MappedSlots>
+{
+public:
+    explicit MappedAVLTree(const std::string& path, const Compare& comp = Compare());
+
+    // Flushes every update made so far to disk.
+    void sync();
+
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Value>::value,
+                  "MappedAVLTree stores items as raw bytes in the file");
+};
+
+template<class Key, class Value, class Compare, class Index>
+MappedAVLTree<Key, Value, Compare, Index>::MappedAVLTree(const std::string& path, const Compare& comp) :
+    CompactAVLTree<Key, Value, Compare, Index, MappedSlots>(comp, path)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Index>
+void MappedAVLTree<Key, Value, Compare, Index>::sync()
+{
+    this->storage_.sync();
+}
+
+#endif
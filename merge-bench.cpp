@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <utility>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+typedef AVLTree<uint32_t, uint32_t> Tree;
+
+/**
+ * Builds two trees of n and m random keys from [0, 2(n + m)), so their key
+ * ranges overlap and some keys collide.  With bulk, the trees come from the
+ * bulk constructor, which allocates the nodes in key order; otherwise they
+ * are built by random inserts and their nodes are scattered in memory.
+ */
+void buildPair(size_t n, size_t m, bool bulk, Tree& big, Tree& small)
+{
+    std::mt19937 rng(49);
+    uint32_t range = (uint32_t)(2 * (n + m));
+    vector<std::pair<uint32_t, uint32_t> > bigItems;
+    vector<std::pair<uint32_t, uint32_t> > smallItems;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t key = rng() % range;
+        bigItems.push_back(std::make_pair(key, key));
+    }
+    for (size_t i = 0; i < m; ++i) {
+        uint32_t key = rng() % range;
+        smallItems.push_back(std::make_pair(key, key + 1));
+    }
+    if (bulk) {
+        big = Tree(bigItems, 1);
+        small = Tree(smallItems, 1);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        big.insert(bigItems[i]);
+    }
+    for (size_t i = 0; i < m; ++i) {
+        small.insert(smallItems[i]);
+    }
+}
+
+void benchMerge(size_t n, size_t m, bool bulk)
+{
+    PerfCounters counters;
+    cout << "n = " << n << ", m = " << m << (bulk ? ", nodes in key order" : ", nodes scattered") << endl;
+    printPerOperationHeader(cout);
+
+    Tree big;
+    Tree small;
+    buildPair(n, m, bulk, big, small);
+    counters.start();
+    for (Tree::iterator it = small.begin(); it != small.end(); ++it) {
+        big.insert(*it);
+    }
+    printPerOperation(cout, "insert each of m (per call)", counters.stop(), 1, counters.available());
+    sink = big.empty() ? 0 : 1;
+
+    Tree big2;
+    Tree small2;
+    buildPair(n, m, bulk, big2, small2);
+    counters.start();
+    big2.merge(std::move(small2));
+    printPerOperation(cout, "merge (per call)", counters.stop(), 1, counters.available());
+    sink = big2.empty() ? 0 : 1;
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    for (int bulk = 0; bulk < 2; ++bulk) {
+        benchMerge(n, n, bulk != 0);
+        benchMerge(n, n / 10, bulk != 0);
+        benchMerge(n, n / 1000, bulk != 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "tree_metrics.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+typedef Node<uint64_t, uint64_t> TreeNode;
+
+volatile uint64_t sink;
+
+// The separate recursive walks the metrics used to take, one per property.
+static int height(TreeNode* node)
+{
+    if (node == NULL) return 0;
+    return 1 + max(height(node->getLeft()), height(node->getRight()));
+}
+
+static bool balanced(TreeNode* node)
+{
+    if (node == NULL) return true;
+    if (abs(height(node->getLeft()) - height(node->getRight())) > 1) return false;
+    return balanced(node->getLeft()) && balanced(node->getRight());
+}
+
+static size_t countNodes(TreeNode* node)
+{
+    return node == NULL ? 0 : 1 + countNodes(node->getLeft()) + countNodes(node->getRight());
+}
+
+static void leafDepths(TreeNode* node, int depth, int& low, int& high)
+{
+    if (node == NULL) return;
+    if (node->getLeft() == NULL && node->getRight() == NULL) {
+        if (low == -1 || depth < low) low = depth;
+        if (depth > high) high = depth;
+    }
+    leafDepths(node->getLeft(), depth + 1, low, high);
+    leafDepths(node->getRight(), depth + 1, low, high);
+}
+
+// Exposes the root of an AVLTree to the benchmark.
+class MeasuredTree : public AVLTree<uint64_t, uint64_t>
+{
+public:
+    TreeNode* root() const { return root_; }
+};
+
+/**
+ * Gathers height, balance, node count and leaf depths of an AVL tree with
+ * one walk per property, then with a single measureTree pass.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(111);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    MeasuredTree tree;
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+
+    counters.start();
+    int h = height(tree.root());
+    bool b = balanced(tree.root());
+    size_t c = countNodes(tree.root());
+    int low = -1;
+    int high = -1;
+    leafDepths(tree.root(), 0, low, high);
+    printPerOperation(cout, "four recursive walks", counters.stop(), n, counters.available());
+
+    counters.start();
+    TreeMetrics metrics = measureTree<GetterChildren<TreeNode> >(tree.root());
+    printPerOperation(cout, "measureTree, all metrics", counters.stop(), n, counters.available());
+
+    counters.start();
+    TreeMetrics shallow = measureTree<GetterChildren<TreeNode> >(tree.root(), METRIC_NODES | METRIC_LEAF_DEPTHS);
+    printPerOperation(cout, "measureTree, count + leaf depths", counters.stop(), n, counters.available());
+
+    counters.start();
+    bool isBalanced = tree.isBalanced();
+    printPerOperation(cout, "isBalanced", counters.stop(), n, counters.available());
+
+    if (metrics.height != h || metrics.balanced != b || metrics.nodes != c || metrics.minLeafDepth != low ||
+        metrics.maxLeafDepth != high || shallow.nodes != c || shallow.maxLeafDepth != high || isBalanced != b) {
+        cout << "mismatch" << endl;
+        return 1;
+    }
+    cout << "height " << h << ", leaf depths " << low << ".." << high << endl;
+    sink = c;
+    return 0;
+}
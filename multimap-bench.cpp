@@ -0,0 +1,118 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "multimapavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+// The per-key container the multimap replaces; the tree needs operator<<
+// for its values.
+struct ValueList
+{
+    vector<uint64_t> values;
+};
+
+ostream& operator<<(ostream& out, const ValueList& list)
+{
+    return out << list.values.size() << " values";
+}
+
+/**
+ * Stores n values under n / dup keys, once as an AVLMultiMap and once as an
+ * AVLTree of vectors, then counts and walks the values of every key.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    size_t dup = 4;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        dup = (size_t)strtoull(argv[2], NULL, 10);
+    }
+    size_t distinct = n / dup;
+
+    vector<uint64_t> keys(n);
+    std::mt19937_64 rng(107);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = rng() % distinct;
+    }
+
+    cout << "n = " << n << ", ~" << dup << " values per key" << endl;
+    printPerOperationHeader(cout);
+    PerfCounters counters;
+
+    uint64_t multiSum = 0;
+    {
+        AVLMultiMap<uint64_t, uint64_t> tree;
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            tree.insert(std::make_pair(keys[i], (uint64_t)i));
+        }
+        printPerOperation(cout, "AVLMultiMap::insert", counters.stop(), n, counters.available());
+
+        counters.start();
+        for (size_t i = 0; i < distinct; ++i) {
+            multiSum += tree.count(keys[i]);
+        }
+        printPerOperation(cout, "AVLMultiMap::count", counters.stop(), distinct, counters.available());
+
+        counters.start();
+        for (size_t i = 0; i < distinct; ++i) {
+            std::pair<uint64_t*, uint64_t*> range = tree.equal_range(keys[i]);
+            for (; range.first != range.second; ++range.first) {
+                multiSum += *range.first;
+            }
+        }
+        printPerOperation(cout, "AVLMultiMap::equal_range walk", counters.stop(), distinct, counters.available());
+    }
+
+    uint64_t vectorSum = 0;
+    {
+        AVLTree<uint64_t, ValueList> tree;
+        counters.start();
+        for (size_t i = 0; i < n; ++i) {
+            AVLTree<uint64_t, ValueList>::iterator it = tree.find(keys[i]);
+            if (it == tree.end()) {
+                ValueList list;
+                list.values.push_back((uint64_t)i);
+                tree.insert(std::make_pair(keys[i], list));
+            } else {
+                it->second.values.push_back((uint64_t)i);
+            }
+        }
+        printPerOperation(cout, "AVLTree<vector>::insert", counters.stop(), n, counters.available());
+
+        counters.start();
+        for (size_t i = 0; i < distinct; ++i) {
+            vectorSum += tree.find(keys[i])->second.values.size();
+        }
+        printPerOperation(cout, "AVLTree<vector>::count", counters.stop(), distinct, counters.available());
+
+        counters.start();
+        for (size_t i = 0; i < distinct; ++i) {
+            const vector<uint64_t>& values = tree.find(keys[i])->second.values;
+            for (size_t j = 0; j < values.size(); ++j) {
+                vectorSum += values[j];
+            }
+        }
+        printPerOperation(cout, "AVLTree<vector> walk", counters.stop(), distinct, counters.available());
+    }
+
+    if (multiSum != vectorSum) {
+        cout << "mismatch: " << multiSum << " vs " << vectorSum << endl;
+        return 1;
+    }
+    sink = multiSum;
+    return 0;
+}
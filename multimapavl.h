@@ -0,0 +1,600 @@
+#ifndef MULTIMAPAVL_H
+#define MULTIMAPAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <new>
+#include <type_traits>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* The values stored under one key of an AVLMultiMap, in insertion order and
+* contiguous in memory.  The first InlineCount values live inside the run
+* itself, and so inside the tree node; only a key with more values than
+* that allocates a separate block, which then grows geometrically.
+*/
+template <typename Value, size_t InlineCount = (sizeof(Value) <= 8 ? 16 / sizeof(Value) : 1)>
+class ValueRun
+{
+public:
+    typedef Value* iterator;
+    typedef const Value* const_iterator;
+
+    ValueRun();
+    explicit ValueRun(const Value& value);
+    ValueRun(const ValueRun& other);
+    ValueRun(ValueRun&& other);
+    ValueRun& operator=(const ValueRun& other);
+    ValueRun& operator=(ValueRun&& other);
+    ~ValueRun();
+
+    size_t size() const;
+    bool empty() const;
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    Value& operator[](size_t index);
+    const Value& operator[](size_t index) const;
+
+    void push_back(const Value& value);
+    // Moves other's values after ours and leaves other empty.  If a value
+    // throws while being copied over, both runs are unchanged.
+    void append(ValueRun&& other);
+    void clear();
+
+private:
+    typedef typename std::aligned_storage<sizeof(Value), alignof(Value)>::type Slot;
+
+    Value* inlineData();
+    bool onHeap() const;
+    void reserve(size_t capacity);
+    // Takes other's values, leaving other empty; this run must be empty.
+    void takeFrom(ValueRun& other);
+    void release();
+
+    Value* data_;
+    size_t size_;
+    size_t capacity_;
+    Slot inline_[InlineCount];
+};
+
+/*
+  ---------------------------------------------
+  Begin implementations for the ValueRun class.
+  ---------------------------------------------
+*/
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>::ValueRun() :
+    data_(inlineData()), size_(0), capacity_(InlineCount)
+{
+
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>::ValueRun(const Value& value) :
+    data_(inlineData()), size_(0), capacity_(InlineCount)
+{
+    push_back(value);
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>::ValueRun(const ValueRun& other) :
+    data_(inlineData()), size_(0), capacity_(InlineCount)
+{
+    reserve(other.size_);
+    try {
+        for (; size_ < other.size_; ++size_) {
+            new (data_ + size_) Value(other.data_[size_]);
+        }
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>::ValueRun(ValueRun&& other) :
+    data_(inlineData()), size_(0), capacity_(InlineCount)
+{
+    takeFrom(other);
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>& ValueRun<Value, InlineCount>::operator=(const ValueRun& other)
+{
+    if (this == &other) return *this;
+    ValueRun copy(other);
+    return *this = std::move(copy);
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>& ValueRun<Value, InlineCount>::operator=(ValueRun&& other)
+{
+    if (this == &other) return *this;
+    release();
+    takeFrom(other);
+    return *this;
+}
+
+template<class Value, size_t InlineCount>
+ValueRun<Value, InlineCount>::~ValueRun()
+{
+    release();
+}
+
+template<class Value, size_t InlineCount>
+Value* ValueRun<Value, InlineCount>::inlineData()
+{
+    return reinterpret_cast<Value*>(inline_);
+}
+
+template<class Value, size_t InlineCount>
+bool ValueRun<Value, InlineCount>::onHeap() const
+{
+    return data_ != reinterpret_cast<const Value*>(inline_);
+}
+
+template<class Value, size_t InlineCount>
+size_t ValueRun<Value, InlineCount>::size() const
+{
+    return size_;
+}
+
+template<class Value, size_t InlineCount>
+bool ValueRun<Value, InlineCount>::empty() const
+{
+    return size_ == 0;
+}
+
+template<class Value, size_t InlineCount>
+typename ValueRun<Value, InlineCount>::iterator ValueRun<Value, InlineCount>::begin()
+{
+    return data_;
+}
+
+template<class Value, size_t InlineCount>
+typename ValueRun<Value, InlineCount>::iterator ValueRun<Value, InlineCount>::end()
+{
+    return data_ + size_;
+}
+
+template<class Value, size_t InlineCount>
+typename ValueRun<Value, InlineCount>::const_iterator ValueRun<Value, InlineCount>::begin() const
+{
+    return data_;
+}
+
+template<class Value, size_t InlineCount>
+typename ValueRun<Value, InlineCount>::const_iterator ValueRun<Value, InlineCount>::end() const
+{
+    return data_ + size_;
+}
+
+template<class Value, size_t InlineCount>
+Value& ValueRun<Value, InlineCount>::operator[](size_t index)
+{
+    return data_[index];
+}
+
+template<class Value, size_t InlineCount>
+const Value& ValueRun<Value, InlineCount>::operator[](size_t index) const
+{
+    return data_[index];
+}
+
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::push_back(const Value& value)
+{
+    if (size_ == capacity_) {
+        // value may live in this run, so copy it before the block moves
+        Value copy(value);
+        reserve(2 * capacity_);
+        new (data_ + size_) Value(std::move(copy));
+    } else {
+        new (data_ + size_) Value(value);
+    }
+    ++size_;
+}
+
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::append(ValueRun&& other)
+{
+    if (this == &other || other.size_ == 0) return;
+    if (size_ + other.size_ > capacity_) {
+        reserve(std::max(2 * capacity_, size_ + other.size_));
+    }
+    size_t i = 0;
+    try {
+        for (; i < other.size_; ++i) {
+            new (data_ + size_ + i) Value(std::move_if_noexcept(other.data_[i]));
+        }
+    } catch (...) {
+        while (i > 0) {
+            data_[size_ + --i].~Value();
+        }
+        throw;
+    }
+    size_ += other.size_;
+    other.clear();
+}
+
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::clear()
+{
+    while (size_ > 0) {
+        data_[--size_].~Value();
+    }
+}
+
+/**
+* Moves the values into a block of the given capacity.  If a value throws
+* while being copied, the new block is freed and the run is unchanged.
+*/
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::reserve(size_t capacity)
+{
+    if (capacity <= capacity_) return;
+    Value* block = static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+    size_t i = 0;
+    try {
+        for (; i < size_; ++i) {
+            new (block + i) Value(std::move_if_noexcept(data_[i]));
+        }
+    } catch (...) {
+        while (i > 0) {
+            block[--i].~Value();
+        }
+        ::operator delete(block);
+        throw;
+    }
+    size_t count = size_;
+    release();
+    data_ = block;
+    size_ = count;
+    capacity_ = capacity;
+}
+
+/**
+* A heap block changes hands as is; inline values are moved one by one.
+*/
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::takeFrom(ValueRun& other)
+{
+    if (other.onHeap()) {
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        other.data_ = other.inlineData();
+        other.size_ = 0;
+        other.capacity_ = InlineCount;
+        return;
+    }
+    try {
+        for (; size_ < other.size_; ++size_) {
+            new (data_ + size_) Value(std::move_if_noexcept(other.data_[size_]));
+        }
+    } catch (...) {
+        clear();
+        throw;
+    }
+    other.clear();
+}
+
+/**
+* Destroys the values and frees a heap block, leaving an empty inline run.
+*/
+template<class Value, size_t InlineCount>
+void ValueRun<Value, InlineCount>::release()
+{
+    clear();
+    if (onHeap()) {
+        ::operator delete(data_);
+        data_ = inlineData();
+        capacity_ = InlineCount;
+    }
+}
+
+template<class Value, size_t InlineCount>
+std::ostream& operator<<(std::ostream& out, const ValueRun<Value, InlineCount>& run)
+{
+    out << '[';
+    for (size_t i = 0; i < run.size(); ++i) {
+        out << (i == 0 ? "" : " ") << run[i];
+    }
+    return out << ']';
+}
+
+/*
+  -------------------------------------------
+  End implementations for the ValueRun class.
+  -------------------------------------------
+*/
+
+/**
+* An AVLNode that also stores the number of values in its subtree.
+*/
+template <typename Key, typename Value>
+class SizedAVLNode : public AVLNode<Key, Value>
+{
+public:
+    SizedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent);
+    virtual ~SizedAVLNode();
+    virtual Node<Key, Value>* clone() const;
+
+    size_t getSize() const;
+    void setSize(size_t size);
+
+protected:
+    size_t size_;
+};
+
+template<class Key, class Value>
+SizedAVLNode<Key, Value>::SizedAVLNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent) :
+    AVLNode<Key, Value>(key, value, parent), size_(value.size())
+{
+
+}
+
+template<class Key, class Value>
+SizedAVLNode<Key, Value>::~SizedAVLNode()
+{
+
+}
+
+template<class Key, class Value>
+Node<Key, Value>* SizedAVLNode<Key, Value>::clone() const
+{
+    return new SizedAVLNode<Key, Value>(*this);
+}
+
+template<class Key, class Value>
+size_t SizedAVLNode<Key, Value>::getSize() const
+{
+    return size_;
+}
+
+template<class Key, class Value>
+void SizedAVLNode<Key, Value>::setSize(size_t size)
+{
+    size_ = size;
+}
+
+/**
+* An AVLTree that keeps every inserted value, including values whose key is
+* already present.  Each key has one node holding the key once and a
+* ValueRun of its values in insertion order, so a key with a few values
+* needs no block besides its node, and equal_range walks a plain array.
+*
+* Nodes store the number of values in their subtree, so size() is O(1)
+* and count(key) is one O(log n) descent.
+*
+* Iteration, find and operator[] are AVLTree's and visit each key once,
+* with its whole run as the value.  Values must be added and removed
+* through this class so the sizes follow: the non-const operator[] is
+* hidden for that reason, and changing a run's length through an iterator
+* leaves size() stale.  A run in a NodeHandle may be changed, since insert
+* recounts it.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class AVLMultiMap : public AVLTree<Key, ValueRun<Value>, Compare>
+{
+public:
+    typedef ValueRun<Value> Run;
+    typedef AVLTree<Key, Run, Compare> Base;
+    typedef typename Base::iterator iterator;
+    typedef typename Base::NodeHandle NodeHandle;
+
+    AVLMultiMap();
+    explicit AVLMultiMap(const Compare& comp);
+
+    // Adds the value after every value with an equal key.
+    void insert (const std::pair<const Key, Value> &new_item);
+    // Adds the run's values after every value with an equal key.
+    virtual void insert (const std::pair<const Key, Run> &new_item);
+    // Links the handle's node, or if the key is present, moves its values
+    // after the existing ones and frees the node.
+    iterator insert(NodeHandle&& handle);
+    // Removes every value with the key at pos and returns the next key.
+    iterator erase(iterator pos);
+    // Moves every value of other into this map in O(n + m), keeping all of
+    // them; for equal keys other's values come after ours.
+    void merge(AVLMultiMap&& other);
+
+    Run const & operator[](const Key& key) const;
+
+    size_t size() const;
+    size_t count(const Key& key) const;
+    // The values with the given key, in insertion order.
+    std::pair<Value*, Value*> equal_range(const Key& key) const;
+
+protected:
+    typedef SizedAVLNode<Key, Run> SNode;
+
+    virtual AVLNode<Key, Run>* createNode(const Key& key, const Run& value, AVLNode<Key, Run>* parent);
+    virtual void updateNode(AVLNode<Key, Run>* node);
+    virtual void afterInsert(AVLNode<Key, Run>* node);
+    virtual void afterRemove(AVLNode<Key, Run>* parent);
+
+    static size_t sizeOf(Node<Key, Run>* node);
+    // Adds added to the sizes from node up to the root, after node's run grew.
+    static void grewBy(AVLNode<Key, Run>* node, size_t added);
+};
+
+template<class Key, class Value, class Compare>
+AVLMultiMap<Key, Value, Compare>::AVLMultiMap() :
+    Base()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLMultiMap<Key, Value, Compare>::AVLMultiMap(const Compare& comp) :
+    Base(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+AVLNode<Key, ValueRun<Value> >* AVLMultiMap<Key, Value, Compare>::createNode(const Key& key, const Run& value,
+                                                                              AVLNode<Key, Run>* parent)
+{
+    return new SNode(key, value, parent);
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::sizeOf(Node<Key, Run>* node)
+{
+    return node == NULL ? 0 : static_cast<SNode*>(node)->getSize();
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::grewBy(AVLNode<Key, Run>* node, size_t added)
+{
+    for (; node != NULL; node = node->getParent()) {
+        SNode* sized = static_cast<SNode*>(node);
+        sized->setSize(sized->getSize() + added);
+    }
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::updateNode(AVLNode<Key, Run>* node)
+{
+    static_cast<SNode*>(node)->setSize(node->getValue().size() + sizeOf(node->getLeft()) + sizeOf(node->getRight()));
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::afterInsert(AVLNode<Key, Run>* node)
+{
+    this->updatePathToRoot(node);
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::afterRemove(AVLNode<Key, Run>* parent)
+{
+    this->updatePathToRoot(parent);
+}
+
+/**
+* A present key costs one descent and an append to its run; only a new key
+* allocates a node.
+*/
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Run>* parent = NULL;
+    bool isLeft = false;
+    Node<Key, Run>* existing = this->findPosition(new_item.first, parent, isLeft);
+    if (existing == NULL) {
+        this->insertAt(std::pair<const Key, Run>(new_item.first, Run(new_item.second)), parent, isLeft);
+        return;
+    }
+    existing->getValue().push_back(new_item.second);
+    grewBy(static_cast<AVLNode<Key, Run>*>(existing), 1);
+}
+
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::insert (const std::pair<const Key, Run> &new_item)
+{
+    if (new_item.second.empty()) return;
+    Node<Key, Run>* parent = NULL;
+    bool isLeft = false;
+    Node<Key, Run>* existing = this->findPosition(new_item.first, parent, isLeft);
+    if (existing == NULL) {
+        this->insertAt(new_item, parent, isLeft);
+        return;
+    }
+    Run copy(new_item.second);
+    existing->getValue().append(std::move(copy));
+    grewBy(static_cast<AVLNode<Key, Run>*>(existing), new_item.second.size());
+}
+
+/**
+* If moving the values over throws, the node goes back into the handle.
+*/
+template<class Key, class Value, class Compare>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::insert(NodeHandle&& handle)
+{
+    if (handle.empty()) return this->end();
+    Node<Key, Run>* parent = NULL;
+    bool isLeft = false;
+    Node<Key, Run>* existing = this->findPosition(handle.key(), parent, isLeft);
+    AVLNode<Key, Run>* node = this->takeNode(handle);
+    if (existing == NULL) {
+        this->linkNode(node, parent, isLeft);
+        return this->iteratorAt(node);
+    }
+
+    size_t added = node->getValue().size();
+    try {
+        existing->getValue().append(std::move(node->getValue()));
+    } catch (...) {
+        handle = this->handleFor(node);
+        throw;
+    }
+    delete node;
+    grewBy(static_cast<AVLNode<Key, Run>*>(existing), added);
+    return this->iteratorAt(existing);
+}
+
+/**
+* Removal relinks nodes rather than moving items, so the successor found
+* beforehand is still the next key afterwards.
+*/
+template<class Key, class Value, class Compare>
+typename AVLMultiMap<Key, Value, Compare>::iterator
+AVLMultiMap<Key, Value, Compare>::erase(iterator pos)
+{
+    Node<Key, Run>* node = this->nodeAt(pos);
+    if (node == NULL) throw std::out_of_range("AVLMultiMap::erase: end iterator");
+    ++pos;
+    this->removeNode(node);
+    return pos;
+}
+
+/**
+* Equal keys keep our node with other's run appended; AVLTree::merge
+* recomputes the sizes of every node it relinks.
+*/
+template<class Key, class Value, class Compare>
+void AVLMultiMap<Key, Value, Compare>::merge(AVLMultiMap&& other)
+{
+    this->mergeNodes(other, [](AVLNode<Key, Run>* ours, AVLNode<Key, Run>* theirs) {
+        ours->getValue().append(std::move(theirs->getValue()));
+        return ours;
+    });
+}
+
+template<class Key, class Value, class Compare>
+ValueRun<Value> const & AVLMultiMap<Key, Value, Compare>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Run, Compare>::operator[](key);
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::size() const
+{
+    return sizeOf(this->root_);
+}
+
+template<class Key, class Value, class Compare>
+size_t AVLMultiMap<Key, Value, Compare>::count(const Key& key) const
+{
+    Node<Key, Run>* node = this->internalFind(key);
+    return node == NULL ? 0 : node->getValue().size();
+}
+
+template<class Key, class Value, class Compare>
+std::pair<Value*, Value*> AVLMultiMap<Key, Value, Compare>::equal_range(const Key& key) const
+{
+    Node<Key, Run>* node = this->internalFind(key);
+    if (node == NULL) return std::pair<Value*, Value*>(NULL, NULL);
+    return std::make_pair(node->getValue().begin(), node->getValue().end());
+}
+
+#endif
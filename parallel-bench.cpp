@@ -0,0 +1,95 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include "bst.h"
+#include "avlbst.h"
+#include "parallel_walk.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+// Some work per item, so the scan is not purely memory bound.
+static uint64_t mix(uint64_t x)
+{
+    for (int i = 0; i < 8; ++i) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+    }
+    return x;
+}
+
+/**
+ * Sums a hash of every value with the iterator, then with parallelReduce
+ * for an increasing number of threads.
+ */
+template<typename Tree>
+bool benchTree(const string& name, const Tree& tree, size_t n, size_t maxThreads)
+{
+    PerfCounters counters;
+    uint64_t expected = 0;
+    counters.start();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        expected += mix(it->second);
+    }
+    printPerOperation(cout, name + " iterator scan", counters.stop(), n, counters.available());
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        counters.start();
+        uint64_t sum = parallelReduce(tree, (uint64_t)0,
+            [](const std::pair<const uint64_t, uint64_t>& item) { return mix(item.second); },
+            [](uint64_t a, uint64_t b) { return a + b; },
+            threads);
+        printPerOperation(cout, name + " parallelReduce, " + to_string(threads) + " threads",
+                          counters.stop(), n, counters.available());
+        if (sum != expected) {
+            cout << "mismatch: " << sum << " vs " << expected << endl;
+            return false;
+        }
+    }
+    sink = expected;
+    return true;
+}
+
+/**
+ * Runs the benchmark on an AVLTree and on an unbalanced BinarySearchTree,
+ * both built from the same shuffled keys.
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 2000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    size_t maxThreads = std::thread::hardware_concurrency();
+    if (argc > 2) {
+        maxThreads = (size_t)strtoull(argv[2], NULL, 10);
+    }
+    if (maxThreads < 8) maxThreads = 8;
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(108);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    AVLTree<uint64_t, uint64_t> avl;
+    BinarySearchTree<uint64_t, uint64_t> bst;
+    for (size_t i = 0; i < n; ++i) {
+        avl.insert(std::make_pair(keys[i], keys[i]));
+        bst.insert(std::make_pair(keys[i], keys[i]));
+    }
+
+    cout << "n = " << n << ", hardware threads = " << std::thread::hardware_concurrency() << endl;
+    printPerOperationHeader(cout);
+    if (!benchTree("AVLTree", avl, n, maxThreads)) return 1;
+    if (!benchTree("BST", bst, n, maxThreads)) return 1;
+    return 0;
+}
@@ -0,0 +1,221 @@
+#ifndef PARALLEL_WALK_H
+#define PARALLEL_WALK_H
+
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <thread>
+#include "bst.h"
+#include "work_stealing_pool.h"
+
+/**
+* Walks a tree on a WorkStealingPool, for parallelForEach and
+* parallelReduce below.  It lives apart from bst.h so that only code that
+* walks in parallel pulls in <thread> and needs -pthread.
+*
+* The split is recursive: a task goes down the left spine of its subtree,
+* hands each large right subtree it passes to the pool as a task of its
+* own, and walks what is left.  So the pieces follow the tree's actual
+* shape, however unbalanced, and idle workers steal the biggest pending
+* pieces first.  A subtree counts as large when its left and right spines
+* are GRAIN_LEVELS nodes long on average: a balanced subtree of a few
+* hundred nodes, a random one of a few thousand.  Smaller subtrees, and
+* chains such as a tree built from sorted inserts, which cannot be split
+* without walking them, stay in one task.
+*
+* Items the tree itself hides (BinarySearchTree::hidden) are skipped.
+*/
+template <typename Key, typename Value, typename Compare>
+class ParallelWalk
+{
+public:
+    typedef BinarySearchTree<Key, Value, Compare> Tree;
+
+    template<typename Function>
+    static void forEach(const Tree& tree, Function& fn, size_t threads);
+    template<typename T, typename Map, typename Combine>
+    static T reduce(const Tree& tree, const T& identity, Map& map, Combine& combine, size_t threads);
+
+private:
+    static const int GRAIN_LEVELS = 8;
+
+    // What one task folded, in key order: a partial result of its own
+    // items, then the result of the right subtree it handed off, if any.
+    template<typename T>
+    struct Part
+    {
+        std::vector<std::pair<T, std::unique_ptr<Part> > > pieces;
+    };
+
+    static bool large(const Node<Key, Value>* node);
+    template<typename T, typename Map, typename Combine>
+    static void fold(const Tree& tree, Node<Key, Value>* node, T& result, Map& map, Combine& combine);
+    template<typename T, typename Map, typename Combine>
+    static void task(const Tree& tree, Node<Key, Value>* node, Part<T>& part, const T& identity,
+                     Map& map, Combine& combine, WorkStealingPool& pool);
+    template<typename T, typename Combine>
+    static T combineParts(const Part<T>& part, const T& identity, Combine& combine);
+};
+
+/**
+* Without subtree sizes, the two spines stand in for the size: a balanced
+* subtree of height h has both about h long, a random one about 0.7 h.
+* Requiring some length on both sides keeps a chain, which would only
+* split into one-node tasks, in a single task.
+*/
+template<typename Key, typename Value, typename Compare>
+bool ParallelWalk<Key, Value, Compare>::large(const Node<Key, Value>* node)
+{
+    int left = 0;
+    int right = 0;
+    for (const Node<Key, Value>* n = node; n != NULL && left < 2 * GRAIN_LEVELS; n = n->getLeft()) ++left;
+    for (const Node<Key, Value>* n = node; n != NULL && right < 2 * GRAIN_LEVELS; n = n->getRight()) ++right;
+    return left + right >= 2 * GRAIN_LEVELS && std::min(left, right) >= GRAIN_LEVELS / 2;
+}
+
+/**
+* In-order walk of the subtree under node with an explicit stack, so it
+* never leaves that subtree.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename T, typename Map, typename Combine>
+void ParallelWalk<Key, Value, Compare>::fold(const Tree& tree, Node<Key, Value>* node, T& result,
+                                             Map& map, Combine& combine)
+{
+    std::vector<Node<Key, Value>*> pending;
+    while (node != NULL || !pending.empty()) {
+        while (node != NULL) {
+            pending.push_back(node);
+            node = node->getLeft();
+        }
+        node = pending.back();
+        pending.pop_back();
+        if (!tree.hidden(node)) {
+            result = combine(result, map(node->getItem()));
+        }
+        node = node->getRight();
+    }
+}
+
+/**
+* The right subtrees are handed off before anything is walked, so other
+* workers can start on them at once.  In key order the task's items are the
+* subtree left at the bottom of the spine, then each spine node from the
+* bottom up followed by its right subtree.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename T, typename Map, typename Combine>
+void ParallelWalk<Key, Value, Compare>::task(const Tree& tree, Node<Key, Value>* node, Part<T>& part,
+                                             const T& identity, Map& map, Combine& combine,
+                                             WorkStealingPool& pool)
+{
+    std::vector<Node<Key, Value>*> spine;
+    std::vector<std::unique_ptr<Part<T> > > handedOff;
+    while (node != NULL && large(node)) {
+        spine.push_back(node);
+        handedOff.push_back(std::unique_ptr<Part<T> >());
+        Node<Key, Value>* right = node->getRight();
+        if (large(right)) {
+            handedOff.back().reset(new Part<T>());
+            Part<T>* child = handedOff.back().get();
+            pool.submit([&tree, right, child, &identity, &map, &combine, &pool] {
+                task(tree, right, *child, identity, map, combine, pool);
+            });
+        }
+        node = node->getLeft();
+    }
+
+    T result = identity;
+    fold(tree, node, result, map, combine);
+    for (size_t i = spine.size(); i-- > 0; ) {
+        if (!tree.hidden(spine[i])) {
+            result = combine(result, map(spine[i]->getItem()));
+        }
+        if (!handedOff[i]) {
+            fold(tree, spine[i]->getRight(), result, map, combine);
+            continue;
+        }
+        part.pieces.push_back(std::make_pair(result, std::move(handedOff[i])));
+        result = identity;
+    }
+    part.pieces.push_back(std::make_pair(result, std::unique_ptr<Part<T> >()));
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename T, typename Combine>
+T ParallelWalk<Key, Value, Compare>::combineParts(const Part<T>& part, const T& identity, Combine& combine)
+{
+    T result = identity;
+    for (size_t i = 0; i < part.pieces.size(); ++i) {
+        result = combine(result, part.pieces[i].first);
+        if (part.pieces[i].second) {
+            result = combine(result, combineParts(*part.pieces[i].second, identity, combine));
+        }
+    }
+    return result;
+}
+
+template<typename Key, typename Value, typename Compare>
+template<typename T, typename Map, typename Combine>
+T ParallelWalk<Key, Value, Compare>::reduce(const Tree& tree, const T& identity, Map& map, Combine& combine,
+                                            size_t threads)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads <= 1 || !large(tree.root_)) {
+        T result = identity;
+        fold(tree, tree.root_, result, map, combine);
+        return result;
+    }
+
+    Part<T> top;
+    {
+        WorkStealingPool pool(threads);
+        Node<Key, Value>* root = tree.root_;
+        pool.submit([&tree, root, &top, &identity, &map, &combine, &pool] {
+            task(tree, root, top, identity, map, combine, pool);
+        });
+        pool.wait();
+    }
+    return combineParts(top, identity, combine);
+}
+
+/**
+* A reduce whose results are all empty.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename Function>
+void ParallelWalk<Key, Value, Compare>::forEach(const Tree& tree, Function& fn, size_t threads)
+{
+    auto visit = [&fn](std::pair<const Key, Value>& item) {
+        fn(item);
+        return false;
+    };
+    auto none = [](bool, bool) { return false; };
+    reduce(tree, false, visit, none, threads);
+}
+
+/**
+* Calls fn on every item of tree using threads workers (0: one per hardware
+* thread).  Items are visited concurrently and in no particular order.
+*/
+template<typename Key, typename Value, typename Compare, typename Function>
+void parallelForEach(const BinarySearchTree<Key, Value, Compare>& tree, Function fn, size_t threads = 0)
+{
+    ParallelWalk<Key, Value, Compare>::forEach(tree, fn, threads);
+}
+
+/**
+* Combines map(item) over all items of tree in key order, using threads
+* workers (0: one per hardware thread).  combine must be associative and
+* identity its neutral element; it need not be commutative.
+*/
+template<typename Key, typename Value, typename Compare, typename T, typename Map, typename Combine>
+T parallelReduce(const BinarySearchTree<Key, Value, Compare>& tree, const T& identity, Map map, Combine combine,
+                 size_t threads = 0)
+{
+    return ParallelWalk<Key, Value, Compare>::reduce(tree, identity, map, combine, threads);
+}
+
+#endif
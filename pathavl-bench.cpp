@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "pathavl.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Times insert, find, a full iteration, an update-heavy churn of
+ * remove/insert pairs, and remove on one tree type.
+ */
+template<typename Tree>
+void benchTree(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& lookups)
+{
+    PerfCounters counters;
+    Tree tree;
+
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    printPerOperation(cout, name + "::insert", counters.stop(), keys.size(), counters.available());
+
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) ++found;
+    }
+    printPerOperation(cout, name + "::find", counters.stop(), lookups.size(), counters.available());
+
+    uint64_t sum = 0;
+    counters.start();
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) {
+        sum += it->second;
+    }
+    printPerOperation(cout, name + "::iterator::operator++", counters.stop(), keys.size(), counters.available());
+
+    // Each step removes a live key and inserts a fresh one, so the size stays
+    // at n while every operation rebalances.
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        tree.remove(lookups[i]);
+        tree.insert(std::make_pair(lookups[i] + keys.size(), lookups[i]));
+    }
+    printPerOperation(cout, name + "::remove+insert", counters.stop(), lookups.size(), counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        tree.remove(lookups[i] + keys.size());
+    }
+    printPerOperation(cout, name + "::remove", counters.stop(), lookups.size(), counters.available());
+    sink = found + sum;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    cout << "bytes per node: AVLNode<uint64_t,uint64_t> = " << sizeof(AVLNode<uint64_t, uint64_t>)
+         << ", PathAVLNode<uint64_t,uint64_t> = " << sizeof(PathAVLNode<uint64_t, uint64_t>)
+         << " (each + malloc header)" << endl;
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    benchTree<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, lookups);
+    benchTree<PathAVLTree<uint64_t, uint64_t> >("PathAVLTree", keys, lookups);
+
+    return 0;
+}
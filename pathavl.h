@@ -0,0 +1,704 @@
+#ifndef PATHAVL_H
+#define PATHAVL_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A node for a PathAVLTree: the item, two child pointers and the balance.
+* There is no parent pointer and no vtable, so on 64-bit builds the links
+* take 16 bytes instead of the 32 an AVLNode spends on its vtable and parent.
+*/
+template <typename Key, typename Value>
+struct PathAVLNode
+{
+    PathAVLNode(const Key& key, const Value& value) :
+        item(key, value),
+        left(NULL),
+        right(NULL),
+        balance(0)
+    {
+
+    }
+
+    std::pair<const Key, Value> item;
+    PathAVLNode* left;
+    PathAVLNode* right;
+    int8_t balance;
+};
+
+/**
+* An AVL tree without parent pointers.
+*
+* insert and remove record the path they walk down as an array of link
+* slots (the address of the root pointer, then of each left_/right_ field
+* followed), and retrace it bottom up.  A rotation only rewrites the link slot
+* above it, so it touches 3 pointers instead of the 6 parent/child updates
+* AVLTree::rotateLeft makes.  Iterators carry the stack of ancestors still to
+* be visited instead of climbing parent links.
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key> >
+class PathAVLTree
+{
+public:
+    typedef PathAVLNode<Key, Value> PathNode;
+
+    // An AVL tree of height 64 needs more than 10^13 nodes, so paths and
+    // iterator stacks never get deeper than this.
+    static const int MAX_HEIGHT = 64;
+
+    PathAVLTree();
+    explicit PathAVLTree(const Compare& comp);
+    ~PathAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool isBalanced() const;
+    bool empty() const;
+
+    /**
+    * An iterator holding the in-order stack: the current node on top and,
+    * below it, each ancestor whose left subtree contains it.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::pair<const Key,Value>& operator*() const;
+        std::pair<const Key,Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PathAVLTree<Key, Value, Compare>;
+        void pushLeftSpine(PathNode* node);
+        PathNode* current() const;
+
+        PathNode* stack_[MAX_HEIGHT];
+        int depth_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    size_t count(const Key& key) const;
+    bool contains(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+    iterator upper_bound(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+protected:
+    PathNode* internalFind(const Key& key) const;
+    PathNode* internalFind(const Key& key, std::false_type threeWay) const;
+    PathNode* internalFind(const Key& key, std::true_type threeWay) const;
+    bool probeLess(const Key& key, const Key& nodeKey) const;
+    bool probeGreater(const Key& key, const Key& nodeKey) const;
+    bool probeLess(const Key& key, const Key& nodeKey, std::false_type threeWay) const;
+    bool probeLess(const Key& key, const Key& nodeKey, std::true_type threeWay) const;
+    bool probeGreater(const Key& key, const Key& nodeKey, std::false_type threeWay) const;
+    bool probeGreater(const Key& key, const Key& nodeKey, std::true_type threeWay) const;
+
+    static void rotateLeft(PathNode** link);
+    static void rotateRight(PathNode** link);
+    static bool rebalanceAfterGrow(PathNode** link, bool grewLeft);
+    static bool rebalanceAfterShrink(PathNode** link, bool shrankLeft);
+    int checkedHeight(PathNode* node) const;
+
+    PathNode* root_;
+    Compare comp_;
+
+private:
+    PathAVLTree(const PathAVLTree&);
+    PathAVLTree& operator=(const PathAVLTree&);
+};
+
+/*
+-----------------------------------------------------------
+Begin implementations for the PathAVLTree::iterator class.
+-----------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+PathAVLTree<Key, Value, Compare>::iterator::iterator() :
+    depth_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::PathNode*
+PathAVLTree<Key, Value, Compare>::iterator::current() const
+{
+    return depth_ == 0 ? NULL : stack_[depth_ - 1];
+}
+
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::iterator::pushLeftSpine(PathNode* node)
+{
+    while (node != NULL) {
+        stack_[depth_++] = node;
+        node = node->left;
+    }
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>&
+PathAVLTree<Key, Value, Compare>::iterator::operator*() const
+{
+    return current()->item;
+}
+
+template<class Key, class Value, class Compare>
+std::pair<const Key,Value>*
+PathAVLTree<Key, Value, Compare>::iterator::operator->() const
+{
+    return &(current()->item);
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::iterator::operator==(const iterator& rhs) const
+{
+    return current() == rhs.current();
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::iterator::operator!=(const iterator& rhs) const
+{
+    return current() != rhs.current();
+}
+
+/**
+* Pops the current node and descends the left spine of its right subtree.
+*/
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator&
+PathAVLTree<Key, Value, Compare>::iterator::operator++()
+{
+    if (depth_ == 0) return *this;
+
+    PathNode* node = stack_[--depth_];
+    pushLeftSpine(node->right);
+    return *this;
+}
+
+/*
+---------------------------------------------------------
+End implementations for the PathAVLTree::iterator class.
+---------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+PathAVLTree<Key, Value, Compare>::PathAVLTree() :
+    root_(NULL),
+    comp_()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+PathAVLTree<Key, Value, Compare>::PathAVLTree(const Compare& comp) :
+    root_(NULL),
+    comp_(comp)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+PathAVLTree<Key, Value, Compare>::~PathAVLTree()
+{
+    clear();
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::empty() const
+{
+    return root_ == NULL;
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeLess(const Key& key, const Key& nodeKey) const
+{
+    return probeLess(key, nodeKey, IsThreeWayCompare<Compare, Key>());
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeLess(const Key& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(key, nodeKey);
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeLess(const Key& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) < 0;
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeGreater(const Key& key, const Key& nodeKey) const
+{
+    return probeGreater(key, nodeKey, IsThreeWayCompare<Compare, Key>());
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeGreater(const Key& key, const Key& nodeKey, std::false_type) const
+{
+    return comp_(nodeKey, key);
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::probeGreater(const Key& key, const Key& nodeKey, std::true_type) const
+{
+    return comp_(key, nodeKey) > 0;
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::PathNode*
+PathAVLTree<Key, Value, Compare>::internalFind(const Key& key) const
+{
+    return internalFind(key, IsThreeWayCompare<Compare, Key>());
+}
+
+/**
+* One comparison per level, testing the last candidate for equality at the
+* bottom (see BinarySearchTree::findPosition).
+*/
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::PathNode*
+PathAVLTree<Key, Value, Compare>::internalFind(const Key& key, std::false_type) const
+{
+    PathNode* current = root_;
+    PathNode* candidate = NULL;
+    while (current != NULL) {
+        if (!probeGreater(key, current->item.first)) {
+            candidate = current;
+            current = current->left;
+        } else {
+            current = current->right;
+        }
+    }
+    if (candidate != NULL && !probeLess(key, candidate->item.first)) {
+        return candidate;
+    }
+    return NULL;
+}
+
+/**
+* Three-way descent: a single comparison per level decides found/left/right.
+*/
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::PathNode*
+PathAVLTree<Key, Value, Compare>::internalFind(const Key& key, std::true_type) const
+{
+    PathNode* current = root_;
+    while (current != NULL) {
+        int order = comp_(key, current->item.first);
+        if (order == 0) {
+            return current;
+        }
+        current = order < 0 ? current->left : current->right;
+    }
+    return NULL;
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator
+PathAVLTree<Key, Value, Compare>::begin() const
+{
+    iterator it;
+    it.pushLeftSpine(root_);
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator
+PathAVLTree<Key, Value, Compare>::end() const
+{
+    return iterator();
+}
+
+/**
+* Builds the iterator stack on the way down: every node where the search
+* turns left is an ancestor still to be visited.  The stack is cut back to
+* the last candidate, since turns below it are not its ancestors.
+*/
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator
+PathAVLTree<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    iterator it;
+    int candidateDepth = 0;
+    PathNode* current = root_;
+    while (current != NULL) {
+        if (!probeGreater(key, current->item.first)) {
+            it.stack_[it.depth_++] = current;
+            candidateDepth = it.depth_;
+            current = current->left;
+        } else {
+            current = current->right;
+        }
+    }
+    it.depth_ = candidateDepth;
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator
+PathAVLTree<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    iterator it;
+    int candidateDepth = 0;
+    PathNode* current = root_;
+    while (current != NULL) {
+        if (probeLess(key, current->item.first)) {
+            it.stack_[it.depth_++] = current;
+            candidateDepth = it.depth_;
+            current = current->left;
+        } else {
+            current = current->right;
+        }
+    }
+    it.depth_ = candidateDepth;
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+typename PathAVLTree<Key, Value, Compare>::iterator
+PathAVLTree<Key, Value, Compare>::find(const Key& key) const
+{
+    iterator it = lower_bound(key);
+    if (it.depth_ != 0 && probeLess(key, it.current()->item.first)) {
+        return end();
+    }
+    return it;
+}
+
+template<class Key, class Value, class Compare>
+size_t PathAVLTree<Key, Value, Compare>::count(const Key& key) const
+{
+    return internalFind(key) == NULL ? 0 : 1;
+}
+
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::contains(const Key& key) const
+{
+    return internalFind(key) != NULL;
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare>
+Value& PathAVLTree<Key, Value, Compare>::operator[](const Key& key)
+{
+    PathNode* node = internalFind(key);
+    if (node == NULL) throw std::out_of_range("Invalid key");
+    return node->item.second;
+}
+
+template<class Key, class Value, class Compare>
+Value const & PathAVLTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    PathNode* node = internalFind(key);
+    if (node == NULL) throw std::out_of_range("Invalid key");
+    return node->item.second;
+}
+
+/**
+* Rotates the subtree hanging off *link; only the link slot and two child
+* fields are written.
+*/
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::rotateLeft(PathNode** link)
+{
+    PathNode* node = *link;
+    PathNode* right = node->right;
+    node->right = right->left;
+    right->left = node;
+    *link = right;
+}
+
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::rotateRight(PathNode** link)
+{
+    PathNode* node = *link;
+    PathNode* left = node->left;
+    node->left = left->right;
+    left->right = node;
+    *link = left;
+}
+
+/**
+* The subtree at *link grew by one level on the given side.  Updates the
+* balance, rotating if it reached +-2, and returns true iff the subtree at
+* *link is now taller than before (so the caller must keep retracing).
+*/
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::rebalanceAfterGrow(PathNode** link, bool grewLeft)
+{
+    PathNode* node = *link;
+    int bal = node->balance + (grewLeft ? -1 : 1);
+    if (bal == 0) {
+        node->balance = 0;
+        return false;
+    }
+    if (bal == -1 || bal == 1) {
+        node->balance = (int8_t)bal;
+        return true;
+    }
+
+    if (bal == -2) {
+        PathNode* left = node->left;
+        if (left->balance == -1) {
+            rotateRight(link);
+            node->balance = 0;
+            left->balance = 0;
+        } else {
+            PathNode* lr = left->right;
+            int lrbal = lr->balance;
+            rotateLeft(&node->left);
+            rotateRight(link);
+            node->balance = (int8_t)(lrbal == -1 ? 1 : 0);
+            left->balance = (int8_t)(lrbal == 1 ? -1 : 0);
+            lr->balance = 0;
+        }
+    } else {
+        PathNode* right = node->right;
+        if (right->balance == 1) {
+            rotateLeft(link);
+            node->balance = 0;
+            right->balance = 0;
+        } else {
+            PathNode* rl = right->left;
+            int rlbal = rl->balance;
+            rotateRight(&node->right);
+            rotateLeft(link);
+            node->balance = (int8_t)(rlbal == 1 ? -1 : 0);
+            right->balance = (int8_t)(rlbal == -1 ? 1 : 0);
+            rl->balance = 0;
+        }
+    }
+    return false;
+}
+
+/**
+* The subtree at *link lost one level on the given side.  Updates the
+* balance, rotating if it reached +-2, and returns true iff the subtree at
+* *link is now shorter than before (so the caller must keep retracing).
+*/
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::rebalanceAfterShrink(PathNode** link, bool shrankLeft)
+{
+    PathNode* node = *link;
+    int bal = node->balance + (shrankLeft ? 1 : -1);
+    if (bal == -1 || bal == 1) {
+        node->balance = (int8_t)bal;
+        return false;
+    }
+    if (bal == 0) {
+        node->balance = 0;
+        return true;
+    }
+
+    if (bal == 2) {
+        PathNode* right = node->right;
+        int rbal = right->balance;
+        if (rbal >= 0) {
+            rotateLeft(link);
+            if (rbal == 0) {
+                node->balance = 1;
+                right->balance = -1;
+                return false;
+            }
+            node->balance = 0;
+            right->balance = 0;
+        } else {
+            PathNode* rl = right->left;
+            int rlbal = rl->balance;
+            rotateRight(&node->right);
+            rotateLeft(link);
+            node->balance = (int8_t)(rlbal == 1 ? -1 : 0);
+            right->balance = (int8_t)(rlbal == -1 ? 1 : 0);
+            rl->balance = 0;
+        }
+    } else {
+        PathNode* left = node->left;
+        int lbal = left->balance;
+        if (lbal <= 0) {
+            rotateRight(link);
+            if (lbal == 0) {
+                node->balance = -1;
+                left->balance = 1;
+                return false;
+            }
+            node->balance = 0;
+            left->balance = 0;
+        } else {
+            PathNode* lr = left->right;
+            int lrbal = lr->balance;
+            rotateLeft(&node->left);
+            rotateRight(link);
+            node->balance = (int8_t)(lrbal == -1 ? 1 : 0);
+            left->balance = (int8_t)(lrbal == 1 ? -1 : 0);
+            lr->balance = 0;
+        }
+    }
+    return true;
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten.
+ */
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    PathNode** path[MAX_HEIGHT + 1];
+    bool wentLeft[MAX_HEIGHT + 1];
+    int depth = 0;
+    PathNode* candidate = NULL;
+
+    PathNode** link = &root_;
+    while (*link != NULL) {
+        PathNode* node = *link;
+        path[depth] = link;
+        if (!probeGreater(keyValuePair.first, node->item.first)) {
+            candidate = node;
+            wentLeft[depth++] = true;
+            link = &node->left;
+        } else {
+            wentLeft[depth++] = false;
+            link = &node->right;
+        }
+    }
+
+    if (candidate != NULL && !probeLess(keyValuePair.first, candidate->item.first)) {
+        candidate->item.second = keyValuePair.second;
+        return;
+    }
+
+    *link = new PathNode(keyValuePair.first, keyValuePair.second);
+    while (depth > 0) {
+        --depth;
+        if (!rebalanceAfterGrow(path[depth], wentLeft[depth])) break;
+    }
+}
+
+/*
+ * A node with two children is replaced by its predecessor, as in AVLTree.
+ */
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::remove(const Key& key)
+{
+    PathNode** path[MAX_HEIGHT + 1];
+    bool wentLeft[MAX_HEIGHT + 1];
+    int depth = 0;
+    int candidateDepth = -1;
+
+    PathNode** link = &root_;
+    while (*link != NULL) {
+        PathNode* node = *link;
+        path[depth] = link;
+        if (!probeGreater(key, node->item.first)) {
+            candidateDepth = depth;
+            wentLeft[depth++] = true;
+            link = &node->left;
+        } else {
+            wentLeft[depth++] = false;
+            link = &node->right;
+        }
+    }
+
+    if (candidateDepth < 0 || probeLess(key, (*path[candidateDepth])->item.first)) return;
+
+    // cut the path back to the node being removed
+    depth = candidateDepth;
+    PathNode** nodeLink = path[depth];
+    PathNode* node = *nodeLink;
+
+    if (node->left != NULL && node->right != NULL) {
+        // walk to the predecessor, recording the path through node's left subtree
+        wentLeft[depth] = true;
+        int nodeDepth = depth++;
+        link = &node->left;
+        while ((*link)->right != NULL) {
+            path[depth] = link;
+            wentLeft[depth++] = false;
+            link = &(*link)->right;
+        }
+
+        PathNode* pred = *link;
+        *link = pred->left;
+        pred->left = node->left;
+        pred->right = node->right;
+        pred->balance = node->balance;
+        *nodeLink = pred;
+
+        // the link below node's level now lives in pred
+        if (nodeDepth + 1 < depth) {
+            path[nodeDepth + 1] = &pred->left;
+        }
+    } else {
+        *nodeLink = node->left != NULL ? node->left : node->right;
+    }
+    delete node;
+
+    while (depth > 0) {
+        --depth;
+        if (!rebalanceAfterShrink(path[depth], wentLeft[depth])) break;
+    }
+}
+
+/**
+* Frees every node with O(1) extra memory by rotating left children up until
+* each node has none, then deleting it and moving right.
+*/
+template<class Key, class Value, class Compare>
+void PathAVLTree<Key, Value, Compare>::clear()
+{
+    PathNode* node = root_;
+    while (node != NULL) {
+        if (node->left != NULL) {
+            PathNode* left = node->left;
+            node->left = left->right;
+            left->right = node;
+            node = left;
+        } else {
+            PathNode* next = node->right;
+            delete node;
+            node = next;
+        }
+    }
+    root_ = NULL;
+}
+
+template<class Key, class Value, class Compare>
+int PathAVLTree<Key, Value, Compare>::checkedHeight(PathNode* node) const
+{
+    if (node == NULL) return 0;
+    int lh = checkedHeight(node->left);
+    int rh = checkedHeight(node->right);
+    if (lh < 0 || rh < 0 || std::abs(lh - rh) > 1) return -1;
+    return 1 + std::max(lh, rh);
+}
+
+/**
+ * Return true iff the tree is balanced.
+ */
+template<class Key, class Value, class Compare>
+bool PathAVLTree<Key, Value, Compare>::isBalanced() const
+{
+    return checkedHeight(root_) >= 0;
+}
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/**
+ * A small wrapper around the Linux perf_event interface that counts the
+ * hardware events we care about when tuning tree layouts: cycles,
+ * instructions, cache misses and branch mispredictions.
+ *
+ * This opens the same counters as the libperf bundled with the hw4 test
+ * suite (LIBPERF_COUNT_HW_*), but as one event group so that all four are
+ * scheduled together and can be read with a single syscall.  Only user-space
+ * events of the calling thread are counted.
+ *
+ * If the kernel refuses to open the counters (no PMU in a VM, or
+ * perf_event_paranoid too strict), available() returns false and only the
+ * wall clock time is reported.
+ */
+class PerfCounters
+{
+public:
+    enum Counter { CYCLES = 0, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+    struct Sample
+    {
+        uint64_t counts[NUM_COUNTERS];
+        uint64_t nanoseconds;
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available() const;
+    void start();
+    Sample stop();
+
+    static const char* counterName(int counter);
+
+private:
+    // non-copyable since we own file descriptors
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+
+    int openCounter(uint64_t config, int groupFd);
+
+    int fds_[NUM_COUNTERS];
+    bool available_;
+    std::chrono::steady_clock::time_point startTime_;
+};
+
+/**
+* Opens one event group containing all of the hardware counters.
+*/
+inline PerfCounters::PerfCounters() :
+    available_(true)
+{
+    static const uint64_t configs[NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+        fds_[i] = -1;
+    }
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+        fds_[i] = openCounter(configs[i], i == 0 ? -1 : fds_[0]);
+        if (fds_[i] < 0) {
+            available_ = false;
+            break;
+        }
+    }
+}
+
+inline PerfCounters::~PerfCounters()
+{
+    for (int i = 0; i < NUM_COUNTERS; ++i) {
+        if (fds_[i] >= 0) close(fds_[i]);
+    }
+}
+
+inline int PerfCounters::openCounter(uint64_t config, int groupFd)
+{
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = (groupFd == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+/**
+ * Returns true iff the hardware counters could be opened.
+ */
+inline bool PerfCounters::available() const
+{
+    return available_;
+}
+
+/**
+ * Resets all counters to zero and starts counting.
+ */
+inline void PerfCounters::start()
+{
+    if (available_) {
+        ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    startTime_ = std::chrono::steady_clock::now();
+}
+
+/**
+ * Stops counting and returns the totals since the last start().
+ * Counts are zero if the hardware counters are unavailable.
+ */
+inline PerfCounters::Sample PerfCounters::stop()
+{
+    Sample sample;
+    std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    std::memset(&sample, 0, sizeof(sample));
+
+    if (available_) {
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // group read layout: { nr, values[nr] }
+        uint64_t buffer[1 + NUM_COUNTERS];
+        if (read(fds_[0], buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer)) {
+            for (int i = 0; i < NUM_COUNTERS; ++i) {
+                sample.counts[i] = buffer[1 + i];
+            }
+        }
+    }
+    sample.nanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime_).count();
+    return sample;
+}
+
+inline const char* PerfCounters::counterName(int counter)
+{
+    static const char* names[NUM_COUNTERS] = { "cycles", "instructions", "cache-misses", "branch-misses" };
+    return names[counter];
+}
+
+/**
+ * Prints one row of per-operation averages for the given sample.
+ */
+inline void printPerOperation(std::ostream& out, const std::string& label, const PerfCounters::Sample& sample,
+                              uint64_t operations, bool countersAvailable)
+{
+    std::ios::fmtflags origFlags(out.flags());
+    double ops = operations == 0 ? 1.0 : (double)operations;
+
+    out << std::left << std::setw(40) << label << std::right << std::fixed << std::setprecision(2);
+    out << std::setw(12) << sample.nanoseconds / ops;
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+        if (countersAvailable) {
+            out << std::setw(18) << sample.counts[i] / ops;
+        } else {
+            out << std::setw(18) << "n/a";
+        }
+    }
+    out << std::endl;
+
+    out.flags(origFlags);
+}
+
+/**
+ * Prints the column headers matching printPerOperation().
+ */
+inline void printPerOperationHeader(std::ostream& out)
+{
+    std::ios::fmtflags origFlags(out.flags());
+
+    out << std::left << std::setw(40) << "operation" << std::right << std::setw(12) << "ns/op";
+    for (int i = 0; i < PerfCounters::NUM_COUNTERS; ++i) {
+        out << std::setw(18) << (std::string(PerfCounters::counterName(i)) + "/op");
+    }
+    out << std::endl;
+
+    out.flags(origFlags);
+}
+
+#endif
@@ -17,8 +17,8 @@
 // 1 means that it is the root.
 // Returns -1 (not found) if the distance is more than PPBST_MAX_HEIGHT,
 // or -2 if the tree is inconsistent.
-template<typename Key, typename Value>
-int getNodeDepth(BinarySearchTree<Key, Value> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
+template<typename Key, typename Value, typename Compare>
+int getNodeDepth(BinarySearchTree<Key, Value, Compare> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
 {
     int dist = 1;
 
@@ -41,6 +41,31 @@ int getNodeDepth(BinarySearchTree<Key, Value> const & tree, Node<Key, Value> * r
     return dist;
 }
 
+// Adapts the tree's comparator (two-way or three-way) to the
+// strict weak ordering that std::map expects.
+template<typename Key, typename Compare>
+struct PPBSTMapCompare
+{
+    Compare comp;
+
+    explicit PPBSTMapCompare(const Compare& c) : comp(c) {}
+
+    bool operator()(const Key& lhs, const Key& rhs) const
+    {
+        return less(lhs, rhs, IsThreeWayCompare<Compare, Key>());
+    }
+
+    bool less(const Key& lhs, const Key& rhs, std::false_type) const
+    {
+        return comp(lhs, rhs);
+    }
+
+    bool less(const Key& lhs, const Key& rhs, std::true_type) const
+    {
+        return comp(lhs, rhs) < 0;
+    }
+};
+
 // Returns the height of the subtree at root.
 // Uses recursion, not height values, so it is bulletproof
 // against incorrect heights.
@@ -92,8 +117,8 @@ int getSubtreeHeight(Node<Key, Value> * root, int recursionDepth = 1)
 
     */
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
+template<typename Key, typename Value, typename Compare>
+void BinarySearchTree<Key, Value, Compare>::printRoot (Node<Key, Value>* root) const
 {
     // special case for empty trees:
     if(root == nullptr)
@@ -127,10 +152,10 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 
     // get placeholders
     // ----------------------------------------------------------------------
-    std::map<Key, uint8_t> valuePlaceholders;
+    std::map<Key, uint8_t, PPBSTMapCompare<Key, Compare> > valuePlaceholders((PPBSTMapCompare<Key, Compare>(comp_)));
 
     uint8_t nextPlaceHolderVal = 1;
-    for(typename BinarySearchTree<Key, Value>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
+    for(typename BinarySearchTree<Key, Value, Compare>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
     {
 
         if(getNodeDepth(*this, root, treeIter.current_) != -1)
@@ -265,7 +290,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
     if(!std::is_same<Key, uint8_t>::value) // print placeholder explanations if needed:
     {
         std::cout << "Tree Placeholders:------------------" << std::endl;
-        for(typename std::map<Key, uint8_t>::iterator placeholdersIter = valuePlaceholders.begin(); placeholdersIter != valuePlaceholders.end(); ++placeholdersIter)
+        for(typename std::map<Key, uint8_t, PPBSTMapCompare<Key, Compare> >::iterator placeholdersIter = valuePlaceholders.begin(); placeholdersIter != valuePlaceholders.end(); ++placeholdersIter)
         {
             std::cout << '[' << std::setfill('0') << std::setw(2) << ((uint16_t)placeholdersIter->second) << "] -> ";
 
@@ -273,7 +298,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
             std::cout.flags(origCoutState);
             std::cout << '(' << placeholdersIter->first << ", ";
 
-            typename BinarySearchTree<Key, Value>::iterator elementIter = this->find(placeholdersIter->first);
+            typename BinarySearchTree<Key, Value, Compare>::iterator elementIter = this->find(placeholdersIter->first);
             if(elementIter == this->end())
             {
                 std::cout << "<error: lookup failed>";
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Times insert, find, a 50% delete / 50% insert mix, and remove on one tree
+ * type.
+ */
+template<typename Tree>
+void benchTree(const string& name, const vector<uint64_t>& keys, const vector<uint64_t>& lookups,
+               const vector<uint64_t>& churn)
+{
+    PerfCounters counters;
+    Tree tree;
+
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    printPerOperation(cout, name + "::insert", counters.stop(), keys.size(), counters.available());
+
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) ++found;
+    }
+    printPerOperation(cout, name + "::find", counters.stop(), lookups.size(), counters.available());
+
+    // even entries delete a random key, odd entries insert one
+    counters.start();
+    for (size_t i = 0; i < churn.size(); ++i) {
+        if (i % 2 == 0) {
+            tree.remove(churn[i]);
+        } else {
+            tree.insert(std::make_pair(churn[i], churn[i]));
+        }
+    }
+    printPerOperation(cout, name + " 50% remove / 50% insert", counters.stop(), churn.size(), counters.available());
+
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        tree.remove(lookups[i]);
+    }
+    printPerOperation(cout, name + "::remove", counters.stop(), lookups.size(), counters.available());
+    sink = found;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> lookups(keys);
+    std::shuffle(lookups.begin(), lookups.end(), rng);
+
+    vector<uint64_t> churn(2 * n);
+    for (size_t i = 0; i < churn.size(); ++i) {
+        churn[i] = rng() % (2 * n);
+    }
+
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+    benchTree<AVLTree<uint64_t, uint64_t> >("AVLTree", keys, lookups, churn);
+    benchTree<RedBlackTree<uint64_t, uint64_t> >("RedBlackTree", keys, lookups, churn);
+
+    return 0;
+}
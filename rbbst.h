@@ -0,0 +1,428 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A node for a red-black tree, which adds the color as a data member.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    enum Color { RED = 0, BLACK = 1 };
+
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+    virtual Node<Key, Value>* clone() const;
+
+    // Getter/setter for the node's color.
+    Color getColor() const;
+    void setColor(Color color);
+
+    // Getters for parent, left, and right, returning RBNodes (see AVLNode).
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    Color color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* New nodes start red, as insertion requires.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), color_(RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+template<class Key, class Value>
+Node<Key, Value>* RBNode<Key, Value>::clone() const
+{
+    return new RBNode<Key, Value>(*this);
+}
+
+template<class Key, class Value>
+typename RBNode<Key, Value>::Color RBNode<Key, Value>::getColor() const
+{
+    return color_;
+}
+
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(Color color)
+{
+    color_ = color;
+}
+
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A red-black tree.  Compared to AVLTree it is less strictly balanced (height
+* up to 2 log n), but a remove does at most 3 rotations and O(1) amortized
+* recoloring, and an insert at most 2 rotations, which suits workloads
+* with many deletes.
+*
+* The inherited isBalanced() checks the AVL height rule, which a valid
+* red-black tree need not meet; use isValidRedBlack() instead.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class RedBlackTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    RedBlackTree();
+    explicit RedBlackTree(const Compare& comp);
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+
+    // Checks the red-black invariants: black root, no red node with a red
+    // child, and the same number of black nodes on every root-to-leaf path.
+    bool isValidRedBlack() const;
+
+protected:
+    typedef RBNode<Key, Value> RB;
+
+    virtual void removeNode(Node<Key, Value>* target);
+    virtual void nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2);
+
+    void rotateLeft(RBNode<Key, Value>* node);
+    void rotateRight(RBNode<Key, Value>* node);
+    void insertFix(RBNode<Key, Value>* node);
+    void removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent);
+    static bool isBlack(RBNode<Key, Value>* node);
+    int blackHeight(RBNode<Key, Value>* node) const;
+};
+
+template<class Key, class Value, class Compare>
+RedBlackTree<Key, Value, Compare>::RedBlackTree() :
+    BinarySearchTree<Key, Value, Compare>()
+{
+
+}
+
+template<class Key, class Value, class Compare>
+RedBlackTree<Key, Value, Compare>::RedBlackTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp)
+{
+
+}
+
+/**
+* Null children count as black leaves.
+*/
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isBlack(RBNode<Key, Value>* node)
+{
+    return node == NULL || node->getColor() == RB::BLACK;
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parentNode = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* existing = this->findPosition(new_item.first, parentNode, isLeft);
+    if(existing != NULL)
+    {
+        existing->setValue(new_item.second);
+        return;
+    }
+
+    RB* parent = static_cast<RB*>(parentNode);
+    RB* newNode = new RB(new_item.first, new_item.second, parent);
+    if(parent == NULL)
+    {
+        newNode->setColor(RB::BLACK);
+        this->root_ = newNode;
+        return;
+    }
+
+    if(isLeft)
+    {
+        parent->setLeft(newNode);
+    }
+    else
+    {
+        parent->setRight(newNode);
+    }
+    if (parent->getColor() == RB::RED)
+        insertFix(newNode);
+}
+
+/**
+* Fixes a red node with a red parent.  Recoloring moves the violation two
+* levels up; the first rotation case ends the loop.
+*/
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::insertFix(RBNode<Key, Value>* node)
+{
+    while (node->getParent() != NULL && node->getParent()->getColor() == RB::RED) {
+        RB* parent = node->getParent();
+        // a red parent is never the root, so the grandparent exists
+        RB* grand = parent->getParent();
+        bool parentIsLeft = grand->getLeft() == parent;
+        RB* uncle = parentIsLeft ? grand->getRight() : grand->getLeft();
+
+        if (!isBlack(uncle)) {
+            parent->setColor(RB::BLACK);
+            uncle->setColor(RB::BLACK);
+            grand->setColor(RB::RED);
+            node = grand;
+            continue;
+        }
+
+        if (parentIsLeft) {
+            if (parent->getRight() == node) {
+                rotateLeft(parent);
+                parent = node;
+            }
+            rotateRight(grand);
+        } else {
+            if (parent->getLeft() == node) {
+                rotateRight(parent);
+                parent = node;
+            }
+            rotateLeft(grand);
+        }
+        parent->setColor(RB::BLACK);
+        grand->setColor(RB::RED);
+        break;
+    }
+    static_cast<RB*>(this->root_)->setColor(RB::BLACK);
+}
+
+/*
+ * A node with two children is swapped with its predecessor first, as in
+ * AVLTree, so the node actually unlinked has at most one child.
+ */
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::removeNode(Node<Key, Value>* target)
+{
+    RB* node = static_cast<RB*>(target);
+    if (node == NULL) return;
+
+    if (node->getLeft() != NULL && node->getRight() != NULL) {
+        RB* pred = static_cast<RB*>(this->predecessor(node));
+        nodeSwap(node, pred);
+    }
+
+    RB* parent = node->getParent();
+    RB* child = node->getLeft() != NULL ? node->getLeft() : node->getRight();
+
+    if (child != NULL) {
+        child->setParent(parent);
+    }
+    if (parent == NULL) {
+        this->root_ = child;
+    } else if (parent->getLeft() == node) {
+        parent->setLeft(child);
+    } else {
+        parent->setRight(child);
+    }
+
+    // removing a red node changes no black heights; a black node with a red
+    // child is replaced by the child recolored black
+    if (node->getColor() == RB::BLACK) {
+        if (!isBlack(child)) {
+            child->setColor(RB::BLACK);
+        } else {
+            removeFix(child, parent);
+        }
+    }
+
+    delete node;
+}
+
+/**
+* node (possibly null) is one black short of its sibling's subtree.  Each
+* pass either ends after at most three rotations or recolors the sibling and
+* moves the deficit up one level.
+*/
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent)
+{
+    while (parent != NULL && isBlack(node)) {
+        if (parent->getLeft() == node) {
+            RB* sibling = parent->getRight();
+            if (sibling->getColor() == RB::RED) {
+                sibling->setColor(RB::BLACK);
+                parent->setColor(RB::RED);
+                rotateLeft(parent);
+                sibling = parent->getRight();
+            }
+            if (isBlack(sibling->getLeft()) && isBlack(sibling->getRight())) {
+                sibling->setColor(RB::RED);
+                node = parent;
+                parent = parent->getParent();
+                continue;
+            }
+            if (isBlack(sibling->getRight())) {
+                sibling->getLeft()->setColor(RB::BLACK);
+                sibling->setColor(RB::RED);
+                rotateRight(sibling);
+                sibling = parent->getRight();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RB::BLACK);
+            sibling->getRight()->setColor(RB::BLACK);
+            rotateLeft(parent);
+        } else {
+            RB* sibling = parent->getLeft();
+            if (sibling->getColor() == RB::RED) {
+                sibling->setColor(RB::BLACK);
+                parent->setColor(RB::RED);
+                rotateRight(parent);
+                sibling = parent->getLeft();
+            }
+            if (isBlack(sibling->getLeft()) && isBlack(sibling->getRight())) {
+                sibling->setColor(RB::RED);
+                node = parent;
+                parent = parent->getParent();
+                continue;
+            }
+            if (isBlack(sibling->getLeft())) {
+                sibling->getRight()->setColor(RB::BLACK);
+                sibling->setColor(RB::RED);
+                rotateLeft(sibling);
+                sibling = parent->getLeft();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RB::BLACK);
+            sibling->getLeft()->setColor(RB::BLACK);
+            rotateRight(parent);
+        }
+        node = static_cast<RB*>(this->root_);
+        break;
+    }
+    if (node != NULL) node->setColor(RB::BLACK);
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::rotateLeft(RBNode<Key, Value>* node)
+{
+    RB* right = node->getRight();
+    RB* parent = node->getParent();
+
+    node->setRight(right->getLeft());
+    if (right->getLeft() != NULL) right->getLeft()->setParent(node);
+
+    right->setLeft(node);
+    node->setParent(right);
+    right->setParent(parent);
+
+    if (parent == NULL) {
+        this->root_ = right;
+    } else if (parent->getLeft() == node) {
+        parent->setLeft(right);
+    } else {
+        parent->setRight(right);
+    }
+}
+
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::rotateRight(RBNode<Key, Value>* node)
+{
+    RB* left = node->getLeft();
+    RB* parent = node->getParent();
+
+    node->setLeft(left->getRight());
+    if (left->getRight() != NULL) left->getRight()->setParent(node);
+
+    left->setRight(node);
+    node->setParent(left);
+    left->setParent(parent);
+
+    if (parent == NULL) {
+        this->root_ = left;
+    } else if (parent->getLeft() == node) {
+        parent->setLeft(left);
+    } else {
+        parent->setRight(left);
+    }
+}
+
+/**
+* Colors belong to positions in the tree, so they are swapped back along
+* with the nodes.
+*/
+template<class Key, class Value, class Compare>
+void RedBlackTree<Key, Value, Compare>::nodeSwap( RBNode<Key,Value>* n1, RBNode<Key,Value>* n2)
+{
+    BinarySearchTree<Key, Value, Compare>::nodeSwap(n1, n2);
+    typename RB::Color tempC = n1->getColor();
+    n1->setColor(n2->getColor());
+    n2->setColor(tempC);
+}
+
+/**
+* Returns the black height of the subtree at node, or -1 if it breaks a
+* red-black invariant.
+*/
+template<class Key, class Value, class Compare>
+int RedBlackTree<Key, Value, Compare>::blackHeight(RBNode<Key, Value>* node) const
+{
+    if (node == NULL) return 1;
+    if (node->getColor() == RB::RED && (!isBlack(node->getLeft()) || !isBlack(node->getRight()))) {
+        return -1;
+    }
+    int lh = blackHeight(node->getLeft());
+    int rh = blackHeight(node->getRight());
+    if (lh < 0 || rh < 0 || lh != rh) return -1;
+    return lh + (node->getColor() == RB::BLACK ? 1 : 0);
+}
+
+template<class Key, class Value, class Compare>
+bool RedBlackTree<Key, Value, Compare>::isValidRedBlack() const
+{
+    RB* root = static_cast<RB*>(this->root_);
+    return isBlack(root) && blackHeight(root) >= 0;
+}
+
+#endif
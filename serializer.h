@@ -0,0 +1,74 @@
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <type_traits>
+
+/**
+* Binary encoding of one key or value for tree snapshots.
+*
+* Trivially copyable types are written as their raw bytes.  Any other type
+* needs a specialization providing
+*
+*     static void write(std::ostream& out, const T& value);
+*     static T read(std::istream& in);
+*
+* and read must throw std::runtime_error if the stream runs dry.
+*/
+template <typename T, typename Enable = void>
+struct Serializer;
+
+template <typename T>
+struct Serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type>
+{
+    static void write(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static T read(std::istream& in)
+    {
+        T value;
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+            throw std::runtime_error("Serializer: unexpected end of input");
+        }
+        return value;
+    }
+};
+
+/**
+* Strings are written as a 64-bit length followed by the characters.
+*/
+template <>
+struct Serializer<std::string>
+{
+    static void write(std::ostream& out, const std::string& value)
+    {
+        Serializer<uint64_t>::write(out, (uint64_t)value.size());
+        out.write(value.data(), value.size());
+    }
+
+    static std::string read(std::istream& in)
+    {
+        uint64_t length = Serializer<uint64_t>::read(in);
+        std::string value;
+        // grow in bounded steps so a corrupt length fails on EOF instead of
+        // allocating gigabytes up front
+        const uint64_t CHUNK = 1 << 16;
+        while (length > 0) {
+            size_t step = (size_t)(length < CHUNK ? length : CHUNK);
+            size_t offset = value.size();
+            value.resize(offset + step);
+            if (!in.read(&value[offset], step)) {
+                throw std::runtime_error("Serializer: unexpected end of input");
+            }
+            length -= step;
+        }
+        return value;
+    }
+};
+
+#endif
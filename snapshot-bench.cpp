@@ -0,0 +1,71 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+/**
+ * Compares warming an AVLTree up with inserts against reloading it from a
+ * snapshot written by save().
+ */
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    string path = "snapshot-bench.avls";
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        path = argv[2];
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i * 7;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    PerfCounters counters;
+    AVLTree<uint64_t, uint64_t> tree;
+
+    cout << "n = " << n << endl;
+    printPerOperationHeader(cout);
+
+    counters.start();
+    for (size_t i = 0; i < n; ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i] + 1));
+    }
+    printPerOperation(cout, "AVLTree::insert (rebuild)", counters.stop(), n, counters.available());
+
+    counters.start();
+    tree.save(path);
+    printPerOperation(cout, "AVLTree::save", counters.stop(), n, counters.available());
+
+    AVLTree<uint64_t, uint64_t> reloaded;
+    counters.start();
+    reloaded.load(path);
+    printPerOperation(cout, "AVLTree::load", counters.stop(), n, counters.available());
+
+    // check the reload before trusting the numbers
+    AVLTree<uint64_t, uint64_t>::iterator a = tree.begin();
+    AVLTree<uint64_t, uint64_t>::iterator b = reloaded.begin();
+    for (; a != tree.end() && b != reloaded.end(); ++a, ++b) {
+        if (a->first != b->first || a->second != b->second) break;
+    }
+    if (a != tree.end() || b != reloaded.end() || !reloaded.isBalanced()) {
+        cout << "reloaded tree does not match" << endl;
+        return 1;
+    }
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "splaybst.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * Draws lookups from a Zipf distribution over the keys: the key of rank r
+ * (a random key, so hot keys are spread over the key space) has weight
+ * 1 / r^s.
+ */
+vector<uint64_t> zipfLookups(const vector<uint64_t>& keys, size_t count, double s, std::mt19937_64& rng)
+{
+    vector<double> cdf(keys.size());
+    double total = 0;
+    for (size_t r = 0; r < keys.size(); ++r) {
+        total += 1.0 / pow((double)(r + 1), s);
+        cdf[r] = total;
+    }
+    std::uniform_real_distribution<double> uniform(0, total);
+    vector<uint64_t> lookups(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t r = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        lookups[i] = keys[std::min(r, keys.size() - 1)];
+    }
+    return lookups;
+}
+
+template<typename Tree>
+void benchFind(const string& name, Tree& tree, const vector<uint64_t>& lookups)
+{
+    PerfCounters counters;
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        if (tree.find(lookups[i]) != tree.end()) ++found;
+    }
+    printPerOperation(cout, name, counters.stop(), lookups.size(), counters.available());
+    sink = found;
+}
+
+/**
+ * Builds the tree from shuffled keys, then times Zipf and uniform lookups.
+ */
+template<typename Tree>
+void benchTree(const string& name, Tree& tree, const vector<uint64_t>& keys,
+               const vector<uint64_t>& zipf, const vector<uint64_t>& uniform)
+{
+    PerfCounters counters;
+    counters.start();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        tree.insert(std::make_pair(keys[i], keys[i]));
+    }
+    printPerOperation(cout, name + "::insert", counters.stop(), keys.size(), counters.available());
+    benchFind(name + "::find zipf", tree, zipf);
+    benchFind(name + "::find uniform", tree, uniform);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t n = 1000000;
+    double s = 0.99;
+    if (argc > 1) {
+        n = (size_t)strtoull(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        s = atof(argv[2]);
+    }
+
+    vector<uint64_t> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i;
+    }
+    std::mt19937_64 rng(104);
+    std::shuffle(keys.begin(), keys.end(), rng);
+    vector<uint64_t> zipf = zipfLookups(keys, 2 * n, s, rng);
+    vector<uint64_t> uniform(keys);
+    std::shuffle(uniform.begin(), uniform.end(), rng);
+
+    cout << "n = " << n << ", zipf s = " << s << endl;
+    printPerOperationHeader(cout);
+    {
+        AVLTree<uint64_t, uint64_t> tree;
+        benchTree("AVLTree", tree, keys, zipf, uniform);
+    }
+    {
+        SplayTree<uint64_t, uint64_t> tree;
+        benchTree("SplayTree", tree, keys, zipf, uniform);
+    }
+    {
+        SplayTree<uint64_t, uint64_t> tree(SplayTree<uint64_t, uint64_t>::SEMI_SPLAY);
+        benchTree("SplayTree<semi>", tree, keys, zipf, uniform);
+    }
+    {
+        SplayTree<uint64_t, uint64_t> tree(SplayTree<uint64_t, uint64_t>::FULL_SPLAY, 8);
+        benchTree("SplayTree<minSplayDepth 8>", tree, keys, zipf, uniform);
+    }
+
+    return 0;
+}
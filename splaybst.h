@@ -0,0 +1,247 @@
+#ifndef SPLAYBST_H
+#define SPLAYBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include "bst.h"
+
+/**
+* A splay tree: every access moves the node it touched towards the root, so
+* keys that are looked up often stay a few levels down.  Plain Nodes are used
+* since no extra per-node data is needed.
+*
+* find is non-const because it restructures the tree; the const find
+* inherited from BinarySearchTree still searches without splaying.
+*
+* Splaying writes to every node on the access path.  To limit that write
+* traffic, SEMI_SPLAY mode rotates only the parent in a zig-zig step and
+* continues from there, roughly halving the depth instead of moving the node
+* to the root.  Independently, minSplayDepth skips splaying for nodes found
+* at that depth or less, so lookups of keys already near the root write
+* nothing.
+*
+* remove always splays the removed node to the root and joins its subtrees.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class SplayTree : public BinarySearchTree<Key, Value, Compare>
+{
+public:
+    enum SplayMode { FULL_SPLAY, SEMI_SPLAY };
+
+    SplayTree();
+    explicit SplayTree(const Compare& comp);
+    explicit SplayTree(SplayMode mode, size_t minSplayDepth = 0, const Compare& comp = Compare());
+
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+
+    typedef typename BinarySearchTree<Key, Value, Compare>::iterator iterator;
+    using BinarySearchTree<Key, Value, Compare>::find;
+    iterator find(const Key& key);
+
+protected:
+    virtual void removeNode(Node<Key, Value>* target);
+
+    void rotateUp(Node<Key, Value>* node);
+    void splay(Node<Key, Value>* node);
+    void semiSplay(Node<Key, Value>* node);
+    void splayAccessed(Node<Key, Value>* node, size_t depth);
+
+    SplayMode mode_;
+    size_t minSplayDepth_;
+};
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree() :
+    BinarySearchTree<Key, Value, Compare>(),
+    mode_(FULL_SPLAY),
+    minSplayDepth_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp),
+    mode_(FULL_SPLAY),
+    minSplayDepth_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare>
+SplayTree<Key, Value, Compare>::SplayTree(SplayMode mode, size_t minSplayDepth, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare>(comp),
+    mode_(mode),
+    minSplayDepth_(minSplayDepth)
+{
+
+}
+
+/*
+ * If key is already in the tree, the current value is overwritten.  The
+ * new or updated node is splayed.
+ */
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parent = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* node = this->findPosition(new_item.first, parent, isLeft);
+    if (node != NULL) {
+        node->setValue(new_item.second);
+    } else {
+        node = new Node<Key, Value>(new_item.first, new_item.second, parent);
+        if (parent == NULL) {
+            this->root_ = node;
+        } else if (isLeft) {
+            parent->setLeft(node);
+        } else {
+            parent->setRight(node);
+        }
+    }
+
+    size_t depth = 0;
+    for (Node<Key, Value>* p = node->getParent(); p != NULL; p = p->getParent()) {
+        ++depth;
+    }
+    splayAccessed(node, depth);
+}
+
+/**
+* Splays the node holding key, or on a miss the last node visited, so
+* repeated misses near the same key also get cheaper.
+*/
+template<class Key, class Value, class Compare>
+typename SplayTree<Key, Value, Compare>::iterator
+SplayTree<Key, Value, Compare>::find(const Key& key)
+{
+    Node<Key, Value>* parent = NULL;
+    bool isLeft = false;
+    Node<Key, Value>* node = this->findPosition(key, parent, isLeft);
+    Node<Key, Value>* accessed = node != NULL ? node : parent;
+    if (accessed != NULL) {
+        size_t depth = 0;
+        for (Node<Key, Value>* p = accessed->getParent(); p != NULL; p = p->getParent()) {
+            ++depth;
+        }
+        splayAccessed(accessed, depth);
+    }
+    return this->iteratorAt(node);
+}
+
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splayAccessed(Node<Key, Value>* node, size_t depth)
+{
+    if (depth <= minSplayDepth_) return;
+    if (mode_ == SEMI_SPLAY) {
+        semiSplay(node);
+    } else {
+        splay(node);
+    }
+}
+
+/**
+* Splays the target to the root, then replaces it by joining its subtrees:
+* the largest node of the left subtree is splayed to the top of that subtree,
+* where it has no right child, and adopts the right subtree.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::removeNode(Node<Key, Value>* target)
+{
+    if (target == NULL) return;
+    splay(target);
+
+    Node<Key, Value>* left = target->getLeft();
+    Node<Key, Value>* right = target->getRight();
+    delete target;
+
+    if (left == NULL) {
+        this->root_ = right;
+        if (right != NULL) right->setParent(NULL);
+        return;
+    }
+
+    left->setParent(NULL);
+    this->root_ = left;
+    Node<Key, Value>* largest = left;
+    while (largest->getRight() != NULL) {
+        largest = largest->getRight();
+    }
+    splay(largest);
+    largest->setRight(right);
+    if (right != NULL) right->setParent(largest);
+}
+
+/**
+* Rotates node above its parent.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::rotateUp(Node<Key, Value>* node)
+{
+    Node<Key, Value>* parent = node->getParent();
+    Node<Key, Value>* grand = parent->getParent();
+
+    if (parent->getLeft() == node) {
+        parent->setLeft(node->getRight());
+        if (node->getRight() != NULL) node->getRight()->setParent(parent);
+        node->setRight(parent);
+    } else {
+        parent->setRight(node->getLeft());
+        if (node->getLeft() != NULL) node->getLeft()->setParent(parent);
+        node->setLeft(parent);
+    }
+    parent->setParent(node);
+    node->setParent(grand);
+
+    if (grand == NULL) {
+        this->root_ = node;
+    } else if (grand->getLeft() == parent) {
+        grand->setLeft(node);
+    } else {
+        grand->setRight(node);
+    }
+}
+
+/**
+* Bottom-up splay with zig, zig-zig and zig-zag steps.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::splay(Node<Key, Value>* node)
+{
+    while (node->getParent() != NULL) {
+        Node<Key, Value>* parent = node->getParent();
+        Node<Key, Value>* grand = parent->getParent();
+        if (grand == NULL) {
+            rotateUp(node);
+        } else if ((grand->getLeft() == parent) == (parent->getLeft() == node)) {
+            rotateUp(parent);
+            rotateUp(node);
+        } else {
+            rotateUp(node);
+            rotateUp(node);
+        }
+    }
+}
+
+/**
+* Semi-splay: a zig-zig step rotates the parent up and continues from the
+* parent, leaving node one level below it; a zig-zag step is as in splay.
+*/
+template<class Key, class Value, class Compare>
+void SplayTree<Key, Value, Compare>::semiSplay(Node<Key, Value>* node)
+{
+    while (node->getParent() != NULL && node->getParent()->getParent() != NULL) {
+        Node<Key, Value>* parent = node->getParent();
+        Node<Key, Value>* grand = parent->getParent();
+        if ((grand->getLeft() == parent) == (parent->getLeft() == node)) {
+            rotateUp(parent);
+            node = parent;
+        } else {
+            rotateUp(node);
+            rotateUp(node);
+        }
+    }
+}
+
+#endif
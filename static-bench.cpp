@@ -0,0 +1,90 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <random>
+#include "bst.h"
+#include "avlbst.h"
+#include "hybridmap.h"
+#include "staticmap.h"
+#include "perf_counters.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+/**
+ * A compile-time table of N keys spread over [0, 4N), like the opcode or
+ * status-code tables this is meant for.
+ */
+template<size_t N>
+struct Table
+{
+    StaticEntry<uint32_t, uint32_t> items[N];
+};
+
+template<size_t N>
+constexpr Table<N> makeTable()
+{
+    Table<N> table = {};
+    for (size_t i = 0; i < N; ++i) {
+        table.items[i].key = (uint32_t)((i * 2654435761u) % (4 * N));
+        table.items[i].value = (uint32_t)i;
+    }
+    return table;
+}
+
+template<typename Map>
+void benchLookups(const string& name, const Map& map, const vector<uint32_t>& lookups, size_t ops)
+{
+    PerfCounters counters;
+    uint64_t found = 0;
+    counters.start();
+    for (size_t i = 0; i < ops; ++i) {
+        if (map.contains(lookups[i % lookups.size()])) ++found;
+    }
+    printPerOperation(cout, name + "::contains", counters.stop(), ops, counters.available());
+    sink = found;
+}
+
+template<size_t N>
+void benchSize(size_t ops)
+{
+    static constexpr Table<N> table = makeTable<N>();
+    static constexpr StaticMap<uint32_t, uint32_t, N> staticMap(table.items);
+
+    AVLTree<uint32_t, uint32_t> tree;
+    HybridMap<uint32_t, uint32_t> hybrid(N, 0);
+    for (size_t i = 0; i < N; ++i) {
+        tree.insert(std::make_pair(table.items[i].key, table.items[i].value));
+        hybrid.insert(std::make_pair(table.items[i].key, table.items[i].value));
+    }
+
+    std::mt19937 rng(47);
+    vector<uint32_t> lookups(4096);
+    for (size_t i = 0; i < lookups.size(); ++i) {
+        lookups[i] = (uint32_t)(rng() % (4 * N));
+    }
+
+    cout << "n = " << N << endl;
+    printPerOperationHeader(cout);
+    benchLookups("AVLTree", tree, lookups, ops);
+    benchLookups("HybridMap (flat)", hybrid, lookups, ops);
+    benchLookups("StaticMap", staticMap, lookups, ops);
+    cout << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t ops = 10000000;
+    if (argc > 1) {
+        ops = (size_t)strtoull(argv[1], NULL, 10);
+    }
+
+    benchSize<16>(ops);
+    benchSize<64>(ops);
+    benchSize<512>(ops);
+
+    return 0;
+}
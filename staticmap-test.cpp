@@ -0,0 +1,180 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include "staticmap.h"
+using namespace std;
+
+int failures = 0;
+
+void check(bool ok, const string& what)
+{
+    if (!ok) {
+        cout << "FAILED: " << what << endl;
+        ++failures;
+    }
+}
+
+/**
+* Everything below is evaluated by the compiler: if the constructor or a
+* lookup could not run in a constant expression, this would not build.
+*/
+constexpr auto statusCodes = makeStaticMap<int, char>({
+    { 404, 'n' }, { 200, 'o' }, { 500, 'e' }, { 301, 'm' }, { 204, 'c' } });
+
+static_assert(statusCodes.size() == 5, "StaticMap::size");
+static_assert(statusCodes[404] == 'n' && statusCodes[200] == 'o' && statusCodes[500] == 'e',
+              "StaticMap::operator[] at compile time");
+static_assert(statusCodes.contains(301) && !statusCodes.contains(302) && !statusCodes.contains(0),
+              "StaticMap::contains at compile time");
+static_assert(statusCodes.find(999) == nullptr && *statusCodes.find(204) == 'c',
+              "StaticMap::find at compile time");
+static_assert(statusCodes.at(0).key == 200 && statusCodes.at(1).key == 204 &&
+              statusCodes.at(2).key == 301 && statusCodes.at(4).key == 500,
+              "StaticMap::at walks the keys in order at compile time");
+
+/**
+* A duplicate key throws from the constructor, which makes a constant
+* expression ill-formed: buildsAtCompileTime substitutes a map of keys
+* 1 and SecondKey into a template argument and falls back to false when
+* that is not a constant.
+*/
+constexpr size_t buildPair(int secondKey)
+{
+    StaticEntry<int, int> items[2] = { { 1, 10 }, { secondKey, 20 } };
+    return StaticMap<int, int, 2>(items).size();
+}
+
+template<int SecondKey, size_t = buildPair(SecondKey)>
+constexpr bool buildsAtCompileTime(int)
+{
+    return true;
+}
+
+template<int SecondKey>
+constexpr bool buildsAtCompileTime(...)
+{
+    return false;
+}
+
+static_assert(buildsAtCompileTime<2>(0), "distinct keys build at compile time");
+static_assert(!buildsAtCompileTime<1>(0), "a duplicate key is not a constant expression");
+
+template<size_t N>
+struct Table
+{
+    StaticEntry<uint32_t, uint32_t> items[N];
+};
+
+/**
+* N distinct keys spread over [0, 4N) in scrambled order: the stride 41
+* is a prime above every N tested, so i -> 41i mod N is a permutation.
+*/
+template<size_t N>
+constexpr Table<N> makeTable()
+{
+    Table<N> table = {};
+    for (size_t i = 0; i < N; ++i) {
+        size_t k = (i * 41) % N;
+        table.items[i].key = (uint32_t)(4 * k + 1);
+        table.items[i].value = (uint32_t)(1000 + i);
+    }
+    return table;
+}
+
+/**
+* Builds the map for one N at compile time and checks every key in
+* [0, 4N] against std::map, then walks it with at().
+*/
+template<size_t N>
+void testSize()
+{
+    static constexpr Table<N> table = makeTable<N>();
+    static constexpr StaticMap<uint32_t, uint32_t, N> map(table.items);
+    static_assert(map.size() == N, "StaticMap::size");
+    static_assert(map.at(0).key == 1 && map.at(N - 1).key == 4 * N - 3, "StaticMap::at at compile time");
+
+    std::map<uint32_t, uint32_t> expected;
+    for (size_t i = 0; i < N; ++i) {
+        expected[table.items[i].key] = table.items[i].value;
+    }
+    string name = "StaticMap<" + to_string(N) + ">";
+
+    bool lookups = true;
+    for (uint32_t key = 0; key <= 4 * N; ++key) {
+        std::map<uint32_t, uint32_t>::const_iterator it = expected.find(key);
+        const uint32_t* value = map.find(key);
+        if (it == expected.end()) {
+            lookups &= value == nullptr && !map.contains(key) && map.count(key) == 0;
+        } else {
+            lookups &= value != nullptr && *value == it->second &&
+                       map.contains(key) && map.count(key) == 1 && map[key] == it->second;
+        }
+    }
+    check(lookups, name + " find/contains/count/operator[] match std::map");
+
+    bool ordered = true;
+    size_t i = 0;
+    for (std::map<uint32_t, uint32_t>::const_iterator it = expected.begin(); it != expected.end(); ++it, ++i) {
+        ordered &= map.at(i).key == it->first && map.at(i).value == it->second;
+    }
+    check(ordered, name + "::at(i) is the i-th smallest item");
+
+    bool threw = false;
+    try {
+        map.at(N);
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    check(threw, name + "::at(size()) throws std::out_of_range");
+
+    threw = false;
+    try {
+        map[4 * N + 2];
+    } catch (const std::out_of_range&) {
+        threw = true;
+    }
+    check(threw, name + "::operator[] throws std::out_of_range on a missing key");
+}
+
+template<size_t N>
+void testSizesUpTo()
+{
+    testSizesUpTo<N - 1>();
+    testSize<N>();
+}
+
+template<>
+void testSizesUpTo<0>()
+{
+}
+
+/**
+* Outside a constant expression a duplicate key is an ordinary exception.
+*/
+void testDuplicateKeys()
+{
+    StaticEntry<int, int> items[3] = { { 5, 1 }, { 3, 2 }, { 5, 3 } };
+    bool threw = false;
+    try {
+        StaticMap<int, int, 3> map(items);
+        (void)map;
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "StaticMap throws std::invalid_argument on a duplicate key");
+}
+
+int main()
+{
+    testSizesUpTo<40>();
+    testDuplicateKeys();
+
+    if (failures != 0) {
+        cout << failures << " check(s) failed" << endl;
+        return 1;
+    }
+    cout << "All checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+#ifndef STATICMAP_H
+#define STATICMAP_H
+
+#if __cplusplus < 201402L
+#error "staticmap.h needs C++14 (constexpr loops); build with -std=c++14 or later"
+#endif
+
+#include <cstddef>
+#include <stdexcept>
+#include <functional>
+
+/**
+* One item of a StaticMap, written { key, value } in the initializer.
+* std::pair cannot be used: its assignment is not constexpr before C++20,
+* and the constructor has to sort the items.
+*/
+template <typename Key, typename Value>
+struct StaticEntry
+{
+    Key key;
+    Value value;
+};
+
+/**
+* An immutable map of N items whose keys are known at compile time.
+*
+* The constructor sorts the items and lays them out as an implicit
+* balanced search tree in one array (the Eytzinger or "heap" layout: the
+* children of slot k are 2k and 2k+1), all in constexpr code, so a
+* constexpr StaticMap is built by the compiler and costs nothing at
+* startup.  A lookup walks down from slot 1 and picks a child with
+* arithmetic on the comparison result instead of a branch; the first few
+* levels sit together in one or two cache lines, and every member is
+* constexpr and therefore inline.
+*
+* Key and Value must be literal types that are default constructible.
+* Duplicate keys throw std::invalid_argument, which in a constant
+* expression is a compile error.
+*/
+template <typename Key, typename Value, size_t N, typename Compare = std::less<Key> >
+class StaticMap
+{
+    static_assert(N > 0, "StaticMap needs at least one item");
+
+public:
+    typedef StaticEntry<Key, Value> Entry;
+
+    constexpr explicit StaticMap(const Entry (&items)[N], const Compare& comp = Compare());
+
+    // Pointer to the value for key, or nullptr.
+    constexpr const Value* find(const Key& key) const;
+    constexpr size_t count(const Key& key) const;
+    constexpr bool contains(const Key& key) const;
+    constexpr size_t size() const;
+
+    /**
+     * @precondition The key exists in the map
+     * Returns the value associated with the key
+     */
+    constexpr const Value& operator[](const Key& key) const;
+
+    // The i-th smallest item, for walking the map in key order.
+    constexpr const Entry& at(size_t i) const;
+
+protected:
+    // Slot of the first key not less than key, or 0 if there is none.
+    constexpr size_t lowerBoundSlot(const Key& key) const;
+    // Stores sorted[next...] into the subtree rooted at slot, in order.
+    constexpr size_t layout(const Entry* sorted, size_t next, size_t slot);
+    // Slot of the i-th smallest item.
+    constexpr size_t slotOf(size_t i) const;
+
+    Entry slots_[N + 1];  // slot 0 is unused
+    Compare comp_;
+};
+
+/**
+* Insertion sort, since N is small and the code has to be constexpr.
+*/
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr StaticMap<Key, Value, N, Compare>::StaticMap(const Entry (&items)[N], const Compare& comp) :
+    slots_(), comp_(comp)
+{
+    Entry sorted[N] = {};
+    for (size_t i = 0; i < N; ++i) {
+        size_t j = i;
+        while (j > 0 && comp_(items[i].key, sorted[j - 1].key)) {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        if (j > 0 && !comp_(sorted[j - 1].key, items[i].key)) {
+            throw std::invalid_argument("StaticMap: duplicate key");
+        }
+        sorted[j] = items[i];
+    }
+    layout(sorted, 0, 1);
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr size_t StaticMap<Key, Value, N, Compare>::layout(const Entry* sorted, size_t next, size_t slot)
+{
+    if (slot > N) return next;
+    next = layout(sorted, next, 2 * slot);
+    slots_[slot] = sorted[next++];
+    return layout(sorted, next, 2 * slot + 1);
+}
+
+/**
+* The walk always runs to the bottom, taking the same number of steps for
+* every key, and remembers the last slot where it turned left: the first
+* key not less than key.  The turn and the remembered slot are computed
+* with arithmetic on the comparison result rather than written as
+* selects, which compilers tend to turn back into branches.
+*/
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr size_t StaticMap<Key, Value, N, Compare>::lowerBoundSlot(const Key& key) const
+{
+    size_t slot = 1;
+    size_t candidate = 0;
+    while (slot <= N) {
+        size_t right = comp_(slots_[slot].key, key);
+        // all ones after a left turn, zero after a right one
+        size_t leftMask = right - 1;
+        candidate ^= (candidate ^ slot) & leftMask;
+        slot = 2 * slot + right;
+    }
+    return candidate;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr const Value* StaticMap<Key, Value, N, Compare>::find(const Key& key) const
+{
+    size_t slot = lowerBoundSlot(key);
+    if (slot == 0 || comp_(key, slots_[slot].key)) return nullptr;
+    return &slots_[slot].value;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr size_t StaticMap<Key, Value, N, Compare>::count(const Key& key) const
+{
+    return find(key) == nullptr ? 0 : 1;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr bool StaticMap<Key, Value, N, Compare>::contains(const Key& key) const
+{
+    return find(key) != nullptr;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr size_t StaticMap<Key, Value, N, Compare>::size() const
+{
+    return N;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr const Value& StaticMap<Key, Value, N, Compare>::operator[](const Key& key) const
+{
+    const Value* value = find(key);
+    if (value == nullptr) throw std::out_of_range("Invalid key");
+    return *value;
+}
+
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr const typename StaticMap<Key, Value, N, Compare>::Entry&
+StaticMap<Key, Value, N, Compare>::at(size_t i) const
+{
+    if (i >= N) throw std::out_of_range("StaticMap::at: index out of range");
+    return slots_[slotOf(i)];
+}
+
+/**
+* Walks down from the root comparing i with the size of the left subtree,
+* which for a complete tree follows from the subtree's height and how full
+* its last level is.
+*/
+template<typename Key, typename Value, size_t N, typename Compare>
+constexpr size_t StaticMap<Key, Value, N, Compare>::slotOf(size_t i) const
+{
+    size_t slot = 1;
+    for (;;) {
+        // size of the subtree under 2 * slot: count the slots per level
+        size_t left = 0;
+        for (size_t first = 2 * slot, width = 1; first <= N; first *= 2, width *= 2) {
+            size_t last = first + width - 1;
+            left += (last <= N ? last : N) - first + 1;
+        }
+        if (i == left) return slot;
+        if (i < left) {
+            slot = 2 * slot;
+        } else {
+            i -= left + 1;
+            slot = 2 * slot + 1;
+        }
+    }
+}
+
+/**
+* Deduces N from the initializer:
+*
+*     constexpr auto codes = makeStaticMap<int, char>({ {404, 'n'}, {200, 'o'} });
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>, size_t N>
+constexpr StaticMap<Key, Value, N, Compare> makeStaticMap(const StaticEntry<Key, Value> (&items)[N],
+                                                         const Compare& comp = Compare())
+{
+    return StaticMap<Key, Value, N, Compare>(items, comp);
+}
+
+#endif
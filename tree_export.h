@@ -0,0 +1,341 @@
+#ifndef TREE_EXPORT_H
+#define TREE_EXPORT_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "bst.h"
+
+/**
+* Limits for exportDot and exportJson.  Zero means no limit.
+*
+* maxDepth     levels to write below the starting node (which is level 0)
+* maxNodes     nodes to write in total
+* sampleDepth  with sampleEvery > 1, of the subtrees hanging at this level
+* sampleEvery  only every sampleEvery-th one, in key order, is written
+* values       write each node's value next to its key
+*
+* Children cut off by any limit are written as a placeholder, so the output
+* still shows where the tree continues.  The starting node is always
+* written, so sampling needs a sampleDepth of at least 1; the export
+* functions throw std::invalid_argument for sampleEvery > 1 with
+* sampleDepth 0.
+*/
+struct TreeExportOptions
+{
+    TreeExportOptions() :
+        maxDepth(0), maxNodes(0), sampleDepth(0), sampleEvery(1), values(true)
+    {
+    }
+
+    size_t maxDepth;
+    size_t maxNodes;
+    size_t sampleDepth;
+    size_t sampleEvery;
+    bool values;
+};
+
+/**
+* Writes a tree, or the subtree under one key, as Graphviz DOT or JSON.
+*
+* The walk is a pre-order traversal with an explicit stack of the open
+* ancestors, so it takes O(n) time for n written nodes and O(height)
+* memory, never recurses and never looks at a node twice.  Node ids are
+* handed out in visiting order.  Keys and values are formatted with
+* operator<<, like printRoot.
+*/
+template <typename Key, typename Value, typename Compare>
+class TreeExporter
+{
+public:
+    static void dot(Node<Key, Value>* start, std::ostream& out, const TreeExportOptions& options);
+    static void json(Node<Key, Value>* start, std::ostream& out, const TreeExportOptions& options);
+
+    static Node<Key, Value>* root(const BinarySearchTree<Key, Value, Compare>& tree);
+    static Node<Key, Value>* nodeFor(const BinarySearchTree<Key, Value, Compare>& tree, const Key& key);
+
+private:
+    struct DotWriter;
+    struct JsonWriter;
+
+    // An open node: its children are still being written.
+    struct Frame
+    {
+        Node<Key, Value>* node;
+        size_t depth;
+        size_t id;
+        int nextChild;  // 0: left, 1: right, 2: done
+    };
+
+    template<typename Writer>
+    static void walk(Node<Key, Value>* start, const TreeExportOptions& options, Writer& writer);
+
+    static std::string format(const Node<Key, Value>* node, bool values);
+    static std::string escape(const std::string& text, bool json);
+};
+
+template<typename Key, typename Value, typename Compare>
+struct TreeExporter<Key, Value, Compare>::DotWriter
+{
+    std::ostream& out;
+    bool values;
+
+    void begin()
+    {
+        out << "digraph BST {\n    node [shape=box];\n";
+    }
+
+    void node(size_t id, size_t parent, bool isLeft, Node<Key, Value>* current)
+    {
+        out << "    n" << id << " [label=\"" << escape(format(current, values), false) << "\"];\n";
+        edge(id, parent, isLeft);
+    }
+
+    void elided(size_t id, size_t parent, bool isLeft)
+    {
+        out << "    n" << id << " [label=\"...\", shape=plaintext];\n";
+        edge(id, parent, isLeft);
+    }
+
+    // The ports keep left children on the left in the drawing.
+    void edge(size_t id, size_t parent, bool isLeft)
+    {
+        if (parent == 0) return;
+        out << "    n" << parent << (isLeft ? ":sw" : ":se") << " -> n" << id << ";\n";
+    }
+
+    void missing()
+    {
+    }
+
+    void between()
+    {
+    }
+
+    void close()
+    {
+    }
+
+    void end()
+    {
+        out << "}\n";
+    }
+};
+
+template<typename Key, typename Value, typename Compare>
+struct TreeExporter<Key, Value, Compare>::JsonWriter
+{
+    std::ostream& out;
+    bool values;
+
+    void begin()
+    {
+    }
+
+    void node(size_t /*id*/, size_t /*parent*/, bool /*isLeft*/, Node<Key, Value>* current)
+    {
+        std::ostringstream key;
+        key << current->getKey();
+        out << "{\"key\": \"" << escape(key.str(), true) << "\"";
+        if (values) {
+            std::ostringstream value;
+            value << current->getValue();
+            out << ", \"value\": \"" << escape(value.str(), true) << "\"";
+        }
+        out << ", \"left\": ";
+    }
+
+    void elided(size_t /*id*/, size_t /*parent*/, bool /*isLeft*/)
+    {
+        out << "{\"elided\": true}";
+    }
+
+    void missing()
+    {
+        out << "null";
+    }
+
+    void between()
+    {
+        out << ", \"right\": ";
+    }
+
+    void close()
+    {
+        out << "}";
+    }
+
+    void end()
+    {
+        out << "\n";
+    }
+};
+
+/**
+* The stack holds only the path from the start node to the node being
+* written; a child is pushed when its parent's frame gets to it.
+*/
+template<typename Key, typename Value, typename Compare>
+template<typename Writer>
+void TreeExporter<Key, Value, Compare>::walk(Node<Key, Value>* start, const TreeExportOptions& options,
+                                             Writer& writer)
+{
+    if (options.sampleEvery > 1 && options.sampleDepth == 0) {
+        throw std::invalid_argument("sampleEvery > 1 needs a sampleDepth of at least 1");
+    }
+    writer.begin();
+    if (start == NULL) {
+        writer.missing();
+        writer.end();
+        return;
+    }
+
+    size_t nextId = 1;
+    size_t written = 1;
+    size_t sampled = 0;
+    std::vector<Frame> path;
+    writer.node(nextId, 0, false, start);
+    Frame first = { start, 0, nextId++, 0 };
+    path.push_back(first);
+
+    while (!path.empty()) {
+        Frame& top = path.back();
+        if (top.nextChild == 2) {
+            writer.close();
+            path.pop_back();
+            continue;
+        }
+
+        bool isLeft = top.nextChild == 0;
+        if (!isLeft) writer.between();
+        ++top.nextChild;
+        Node<Key, Value>* child = isLeft ? top.node->getLeft() : top.node->getRight();
+        if (child == NULL) {
+            writer.missing();
+            continue;
+        }
+
+        size_t depth = top.depth + 1;
+        bool keep = (options.maxDepth == 0 || depth <= options.maxDepth) &&
+                    (options.maxNodes == 0 || written < options.maxNodes);
+        if (keep && options.sampleEvery > 1 && depth == options.sampleDepth) {
+            keep = sampled++ % options.sampleEvery == 0;
+        }
+        if (!keep) {
+            writer.elided(nextId++, top.id, isLeft);
+            continue;
+        }
+
+        writer.node(nextId, top.id, isLeft, child);
+        ++written;
+        Frame frame = { child, depth, nextId++, 0 };
+        path.push_back(frame);  // may move top, which is not used again
+    }
+    writer.end();
+}
+
+template<typename Key, typename Value, typename Compare>
+void TreeExporter<Key, Value, Compare>::dot(Node<Key, Value>* start, std::ostream& out,
+                                            const TreeExportOptions& options)
+{
+    DotWriter writer = { out, options.values };
+    walk(start, options, writer);
+}
+
+template<typename Key, typename Value, typename Compare>
+void TreeExporter<Key, Value, Compare>::json(Node<Key, Value>* start, std::ostream& out,
+                                             const TreeExportOptions& options)
+{
+    JsonWriter writer = { out, options.values };
+    walk(start, options, writer);
+}
+
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* TreeExporter<Key, Value, Compare>::root(const BinarySearchTree<Key, Value, Compare>& tree)
+{
+    return tree.root_;
+}
+
+template<typename Key, typename Value, typename Compare>
+Node<Key, Value>* TreeExporter<Key, Value, Compare>::nodeFor(const BinarySearchTree<Key, Value, Compare>& tree,
+                                                             const Key& key)
+{
+    Node<Key, Value>* node = tree.internalFind(key);
+    if (node == NULL) throw std::out_of_range("Invalid key");
+    return node;
+}
+
+template<typename Key, typename Value, typename Compare>
+std::string TreeExporter<Key, Value, Compare>::format(const Node<Key, Value>* node, bool values)
+{
+    std::ostringstream text;
+    text << node->getKey();
+    if (values) text << ": " << node->getValue();
+    return text.str();
+}
+
+template<typename Key, typename Value, typename Compare>
+std::string TreeExporter<Key, Value, Compare>::escape(const std::string& text, bool json)
+{
+    static const char HEX[] = "0123456789abcdef";
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += (char)c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c < 0x20 && json) {
+            escaped += "\\u00";
+            escaped += HEX[c >> 4];
+            escaped += HEX[c & 0xf];
+        } else {
+            escaped += (char)c;
+        }
+    }
+    return escaped;
+}
+
+/**
+* Writes the whole tree, or the subtree under key, as a Graphviz digraph.
+* The key overloads throw std::out_of_range if key is not in the tree.
+*/
+template<typename Key, typename Value, typename Compare>
+void exportDot(const BinarySearchTree<Key, Value, Compare>& tree, std::ostream& out,
+               const TreeExportOptions& options = TreeExportOptions())
+{
+    TreeExporter<Key, Value, Compare>::dot(TreeExporter<Key, Value, Compare>::root(tree), out, options);
+}
+
+template<typename Key, typename Value, typename Compare>
+void exportDot(const BinarySearchTree<Key, Value, Compare>& tree, const Key& key, std::ostream& out,
+               const TreeExportOptions& options = TreeExportOptions())
+{
+    TreeExporter<Key, Value, Compare>::dot(TreeExporter<Key, Value, Compare>::nodeFor(tree, key), out, options);
+}
+
+/**
+* Writes the whole tree, or the subtree under key, as nested JSON objects
+* {"key": ..., "value": ..., "left": ..., "right": ...} with null for a
+* missing child and {"elided": true} for one cut off by the options.  Keys
+* and values are written as strings.
+*/
+template<typename Key, typename Value, typename Compare>
+void exportJson(const BinarySearchTree<Key, Value, Compare>& tree, std::ostream& out,
+                const TreeExportOptions& options = TreeExportOptions())
+{
+    TreeExporter<Key, Value, Compare>::json(TreeExporter<Key, Value, Compare>::root(tree), out, options);
+}
+
+template<typename Key, typename Value, typename Compare>
+void exportJson(const BinarySearchTree<Key, Value, Compare>& tree, const Key& key, std::ostream& out,
+                const TreeExportOptions& options = TreeExportOptions())
+{
+    TreeExporter<Key, Value, Compare>::json(TreeExporter<Key, Value, Compare>::nodeFor(tree, key), out, options);
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef TREE_METRICS_H
+#define TREE_METRICS_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <utility>
+
+/**
+* Shape metrics of a binary tree, gathered by measureTree in one walk.
+* This header names no node type of its own, so it can be used both with
+* equal-paths.h's Node and with bst.h's Node<Key, Value>.
+*/
+enum TreeMetric
+{
+    METRIC_NODES = 1,        // number of nodes
+    METRIC_HEIGHT = 2,       // nodes on the longest root-to-leaf path
+    METRIC_LEAF_DEPTHS = 4,  // shallowest and deepest leaf (the root is at depth 0)
+    METRIC_BALANCE = 8,      // whether every node's subtree heights differ by at most one
+    METRIC_ALL = 15
+};
+
+struct TreeMetrics
+{
+    size_t nodes;
+    int height;
+    int minLeafDepth;   // -1 for an empty tree
+    int maxLeafDepth;
+    bool balanced;
+    // False when stopOnFailure ended the walk early; then only the failed
+    // property is meaningful.
+    bool complete;
+
+    bool equalLeafDepths() const { return minLeafDepth == maxLeafDepth; }
+};
+
+/**
+* Children adapters: how measureTree gets from a node to its children.
+* FieldChildren reads public left/right members, GetterChildren calls
+* getLeft()/getRight().
+*/
+template <typename NodeType>
+struct FieldChildren
+{
+    static NodeType* left(const NodeType* node) { return node->left; }
+    static NodeType* right(const NodeType* node) { return node->right; }
+};
+
+template <typename NodeType>
+struct GetterChildren
+{
+    static NodeType* left(const NodeType* node) { return node->getLeft(); }
+    static NodeType* right(const NodeType* node) { return node->getRight(); }
+};
+
+/**
+* Computes the requested metrics (a mask of TreeMetric values) in one
+* iterative O(n) walk using O(height) memory, so deep trees cannot overflow
+* the call stack.  Heights and balance need each subtree's height, so they
+* use a post-order walk; node count and leaf depths alone use a cheaper
+* pre-order walk.
+*
+* With stopOnFailure, the walk ends at the first unbalanced node (if
+* METRIC_BALANCE is requested) or at the first leaf depth differing from
+* an earlier one (if METRIC_LEAF_DEPTHS is requested), and complete is
+* cleared.  The pre-order walk also ends at an inner node as deep as a
+* leaf seen earlier, since the leaves below it are deeper still; then
+* maxLeafDepth is only a lower bound.  Metrics that were not requested are left at their empty-tree
+* values.
+*/
+template <typename Children, typename NodeType>
+TreeMetrics measureTree(NodeType* root, unsigned metrics = METRIC_ALL, bool stopOnFailure = false)
+{
+    TreeMetrics result = { 0, 0, -1, -1, true, true };
+    if (root == NULL) return result;
+
+    const bool wantLeaves = (metrics & METRIC_LEAF_DEPTHS) != 0;
+    const bool stopOnLeaves = stopOnFailure && wantLeaves;
+
+    if ((metrics & (METRIC_HEIGHT | METRIC_BALANCE)) == 0) {
+        // pre-order: follow left children, keep right children for later
+        std::vector<std::pair<NodeType*, int> > pending;
+        NodeType* node = root;
+        int depth = 0;
+        for (;;) {
+            ++result.nodes;
+            NodeType* left = Children::left(node);
+            NodeType* right = Children::right(node);
+            if (left == NULL && right == NULL) {
+                if (result.minLeafDepth == -1 || depth < result.minLeafDepth) result.minLeafDepth = depth;
+                if (depth > result.maxLeafDepth) result.maxLeafDepth = depth;
+                if (stopOnLeaves && result.minLeafDepth != result.maxLeafDepth) {
+                    result.complete = false;
+                    break;
+                }
+                if (pending.empty()) break;
+                node = pending.back().first;
+                depth = pending.back().second;
+                pending.pop_back();
+                continue;
+            }
+            // every leaf below an inner node at or past a known leaf depth
+            // is deeper than that leaf
+            if (stopOnLeaves && result.maxLeafDepth != -1 && depth >= result.maxLeafDepth) {
+                result.maxLeafDepth = depth + 1;
+                result.complete = false;
+                break;
+            }
+            ++depth;
+            if (left == NULL) {
+                node = right;
+                continue;
+            }
+            if (right != NULL) pending.push_back(std::make_pair(right, depth));
+            node = left;
+        }
+    } else {
+        // post-order: a frame learns its children's heights as they finish
+        struct Frame
+        {
+            NodeType* node;
+            int leftHeight;
+            int rightHeight;
+            int next;  // 0: visit left, 1: visit right, 2: finish
+        };
+        std::vector<Frame> path;
+        Frame first = { root, 0, 0, 0 };
+        path.push_back(first);
+        const bool stopOnBalance = stopOnFailure && (metrics & METRIC_BALANCE) != 0;
+
+        while (!path.empty()) {
+            Frame& top = path.back();
+            if (top.next == 0) {
+                ++result.nodes;
+                top.next = 1;
+                NodeType* left = Children::left(top.node);
+                if (left == NULL && Children::right(top.node) == NULL) {
+                    int depth = (int)path.size() - 1;
+                    if (result.minLeafDepth == -1 || depth < result.minLeafDepth) result.minLeafDepth = depth;
+                    if (depth > result.maxLeafDepth) result.maxLeafDepth = depth;
+                    if (stopOnLeaves && result.minLeafDepth != result.maxLeafDepth) {
+                        result.complete = false;
+                        break;
+                    }
+                }
+                if (left != NULL) {
+                    Frame child = { left, 0, 0, 0 };
+                    path.push_back(child);  // top is not used again this round
+                }
+                continue;
+            }
+            if (top.next == 1) {
+                top.next = 2;
+                NodeType* right = Children::right(top.node);
+                if (right != NULL) {
+                    Frame child = { right, 0, 0, 0 };
+                    path.push_back(child);
+                }
+                continue;
+            }
+
+            int height = 1 + (top.leftHeight > top.rightHeight ? top.leftHeight : top.rightHeight);
+            if (std::abs(top.leftHeight - top.rightHeight) > 1) {
+                result.balanced = false;
+                if (stopOnBalance) {
+                    result.complete = false;
+                    break;
+                }
+            }
+            path.pop_back();
+            if (path.empty()) {
+                result.height = height;
+            } else if (path.back().next == 1) {
+                path.back().leftHeight = height;
+            } else {
+                path.back().rightHeight = height;
+            }
+        }
+    }
+
+    if (!wantLeaves) {
+        result.minLeafDepth = -1;
+        result.maxLeafDepth = -1;
+    }
+    if ((metrics & METRIC_NODES) == 0) result.nodes = 0;
+    if ((metrics & METRIC_HEIGHT) == 0) result.height = 0;
+    if ((metrics & METRIC_BALANCE) == 0) result.balanced = true;
+    return result;
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+* A fixed set of worker threads, each with its own task deque.  A worker
+* runs tasks from the back of its own deque and, when that is empty, steals
+* from the front of the others, so uneven tasks even out without a shared
+* queue everyone contends on.
+*
+* Tasks submitted from inside a task go to the submitting worker's deque;
+* tasks from other threads are dealt round-robin.  wait() blocks until every
+* submitted task has finished and rethrows the first exception a task threw.
+*/
+class WorkStealingPool
+{
+public:
+    // threads == 0 uses one worker per hardware thread.
+    explicit WorkStealingPool(size_t threads = 0);
+    ~WorkStealingPool();
+
+    void submit(const std::function<void()>& task);
+    void wait();
+    size_t size() const;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    void workerLoop(size_t index);
+    bool takeTask(size_t index, std::function<void()>& task);
+    // Index of the worker running on this thread in this pool, or size().
+    size_t currentWorker() const;
+    static const WorkStealingPool*& currentPool();
+    static size_t& currentIndex();
+
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;  // tasks were queued, or the pool is stopping
+    std::condition_variable idle_;  // pending_ dropped to zero
+    size_t queued_;                 // tasks sitting in some deque
+    size_t pending_;                // tasks submitted and not finished
+    size_t next_;
+    bool stopping_;
+    std::exception_ptr error_;
+
+    WorkStealingPool(const WorkStealingPool&);
+    WorkStealingPool& operator=(const WorkStealingPool&);
+};
+
+inline WorkStealingPool::WorkStealingPool(size_t threads) :
+    queued_(0),
+    pending_(0),
+    next_(0),
+    stopping_(false)
+{
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+    }
+}
+
+/**
+* Finishes the queued tasks, then joins the workers.
+*/
+inline WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return pending_ == 0; });
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+}
+
+inline size_t WorkStealingPool::size() const
+{
+    return workers_.size();
+}
+
+inline const WorkStealingPool*& WorkStealingPool::currentPool()
+{
+    static thread_local const WorkStealingPool* pool = nullptr;
+    return pool;
+}
+
+inline size_t& WorkStealingPool::currentIndex()
+{
+    static thread_local size_t index = 0;
+    return index;
+}
+
+inline size_t WorkStealingPool::currentWorker() const
+{
+    return currentPool() == this ? currentIndex() : queues_.size();
+}
+
+inline void WorkStealingPool::submit(const std::function<void()>& task)
+{
+    size_t target = currentWorker();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (target == queues_.size()) {
+            target = next_++ % queues_.size();
+        }
+        ++pending_;
+        ++queued_;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(task);
+    }
+    wake_.notify_one();
+}
+
+inline void WorkStealingPool::wait()
+{
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_.wait(lock, [this] { return pending_ == 0; });
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) std::rethrow_exception(error);
+}
+
+/**
+* Pops the newest task of the worker's own deque, else steals the oldest
+* task of the next non-empty deque after it.
+*/
+inline bool WorkStealingPool::takeTask(size_t index, std::function<void()>& task)
+{
+    {
+        Queue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task.swap(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Queue& victim = *queues_[(index + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task.swap(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void WorkStealingPool::workerLoop(size_t index)
+{
+    currentPool() = this;
+    currentIndex() = index;
+
+    std::function<void()> task;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+            if (queued_ == 0) return;
+        }
+        // another worker may take the task first; then just wait again
+        if (!takeTask(index, task)) continue;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --queued_;
+        }
+
+        std::exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !error_) error_ = error;
+        if (--pending_ == 0) idle_.notify_all();
+    }
+}
+
+#endif